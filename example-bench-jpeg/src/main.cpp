@@ -0,0 +1,138 @@
+#include "ofMain.h"
+
+#include "ofxAzureKinect.h"
+
+// Decodes the MJPEG color of a recording inline and on 1, 2, 4 and 8 decoder workers,
+// and prints the decode rate for each.
+// Usage: example-bench-jpeg [recording.mkv] [max frames] [downscale]
+
+const size_t DEFAULT_MAX_FRAMES = 300;
+const size_t NUM_PASSES = 3;
+
+double decodeInline(const std::vector<k4a::image>& jpegImgs, int downscale)
+{
+	tjhandle handle = tjInitDecompress();
+	ofPixels pix;
+
+	const auto startTime = std::chrono::steady_clock::now();
+	for (const auto& jpegImg : jpegImgs)
+	{
+		ofxAzureKinect::JpegDecoder::decode(handle, jpegImg, pix, downscale);
+	}
+	const auto elapsed = std::chrono::steady_clock::now() - startTime;
+
+	tjDestroy(handle);
+
+	return std::chrono::duration<double>(elapsed).count();
+}
+
+double decodePooled(const std::vector<k4a::image>& jpegImgs, size_t numThreads, int downscale)
+{
+	ofxAzureKinect::JpegDecoder decoder;
+	if (!decoder.setup(numThreads, downscale)) return std::numeric_limits<double>::max();
+
+	ofPixels pix;
+	std::deque<uint64_t> tickets;
+
+	// Keep one job in flight per worker, like the stream does.
+	const auto startTime = std::chrono::steady_clock::now();
+	for (const auto& jpegImg : jpegImgs)
+	{
+		tickets.push_back(decoder.submit(jpegImg));
+		if (tickets.size() >= numThreads)
+		{
+			decoder.wait(tickets.front(), pix);
+			tickets.pop_front();
+		}
+	}
+	while (!tickets.empty())
+	{
+		decoder.wait(tickets.front(), pix);
+		tickets.pop_front();
+	}
+	const auto elapsed = std::chrono::steady_clock::now() - startTime;
+
+	decoder.close();
+
+	return std::chrono::duration<double>(elapsed).count();
+}
+
+void printResult(const std::string& label, size_t numFrames, double seconds, double baselineSeconds)
+{
+	std::cout << std::left << std::setw(10) << label
+		<< std::right << std::setw(10) << std::fixed << std::setprecision(1) << (numFrames / seconds) << " fps"
+		<< std::setw(10) << std::setprecision(2) << (seconds * 1000.0 / numFrames) << " ms/frame"
+		<< std::setw(8) << std::setprecision(2) << (baselineSeconds / seconds) << "x" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	const std::string filepath = ofToDataPath(argc > 1 ? argv[1] : "recording.mkv", true);
+	const size_t maxFrames = argc > 2 ? ofToInt(argv[2]) : DEFAULT_MAX_FRAMES;
+	const int downscale = argc > 3 ? ofToInt(argv[3]) : 1;
+
+	if (!ofxAzureKinect::JpegDecoder::isValidDownscale(downscale))
+	{
+		ofLogError(__FUNCTION__) << "Downscale must be 1, 2, 4 or 8!";
+		return 1;
+	}
+
+	// Read the compressed color images up front so that only decoding is timed.
+	std::vector<k4a::image> jpegImgs;
+	try
+	{
+		k4a::playback playback = k4a::playback::open(filepath.c_str());
+		if (playback.get_record_configuration().color_format != K4A_IMAGE_FORMAT_COLOR_MJPG)
+		{
+			ofLogError(__FUNCTION__) << filepath << " does not have MJPEG color!";
+			return 1;
+		}
+
+		k4a::capture capture;
+		while (jpegImgs.size() < maxFrames && playback.get_next_capture(&capture))
+		{
+			k4a::image colorImg = capture.get_color_image();
+			if (colorImg)
+			{
+				jpegImgs.push_back(std::move(colorImg));
+			}
+		}
+	}
+	catch (const k4a::error& e)
+	{
+		ofLogError(__FUNCTION__) << e.what();
+		return 1;
+	}
+
+	if (jpegImgs.empty())
+	{
+		ofLogError(__FUNCTION__) << "No color images in " << filepath << "!";
+		return 1;
+	}
+
+	std::cout << "Decoding " << jpegImgs.size() << " frames of " << jpegImgs.front().get_width_pixels() << "x" << jpegImgs.front().get_height_pixels()
+		<< " MJPEG at 1/" << downscale << " scale, best of " << NUM_PASSES << " passes, "
+		<< std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+
+	// Warm up the caches and the turbojpeg code paths.
+	decodeInline(jpegImgs, downscale);
+
+	double inlineSeconds = std::numeric_limits<double>::max();
+	for (size_t pass = 0; pass < NUM_PASSES; ++pass)
+	{
+		inlineSeconds = std::min(inlineSeconds, decodeInline(jpegImgs, downscale));
+	}
+	printResult("inline", jpegImgs.size(), inlineSeconds, inlineSeconds);
+
+	for (size_t numThreads : { 1, 2, 4, 8 })
+	{
+		double pooledSeconds = std::numeric_limits<double>::max();
+		for (size_t pass = 0; pass < NUM_PASSES; ++pass)
+		{
+			pooledSeconds = std::min(pooledSeconds, decodePooled(jpegImgs, numThreads, downscale));
+		}
+		printResult(ofToString(numThreads) + " thread" + (numThreads > 1 ? "s" : ""), jpegImgs.size(), pooledSeconds, inlineSeconds);
+	}
+
+	return 0;
+}
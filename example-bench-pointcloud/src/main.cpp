@@ -0,0 +1,195 @@
+#include "ofMain.h"
+
+#include "ofxAzureKinect.h"
+#include "ofxAzureKinect/HalfFloat.h"
+
+// Times the point cloud kernels on NFOV, WFOV, 1080p and 2160p sized frames, with float
+// and half float tables, and checks that every SIMD kernel matches the scalar one bit for bit.
+// Exits with 1 on any mismatch.
+// Usage: example-bench-pointcloud [passes]
+
+using ofxAzureKinect::PointCloudBuilder;
+
+const size_t DEFAULT_NUM_PASSES = 20;
+
+struct FrameSize
+{
+	std::string name;
+	int width;
+	int height;
+};
+
+struct TestFrame
+{
+	int width;
+	int height;
+	std::vector<uint16_t> depth;
+	std::vector<k4a_float2_t> table;
+	std::vector<uint16_t> halfTable;
+};
+
+// Pinhole table with an invalid border and a few NaNs, and depth with holes, like real data.
+TestFrame makeFrame(const FrameSize& size)
+{
+	TestFrame frame;
+	frame.width = size.width;
+	frame.height = size.height;
+
+	const size_t numPixels = static_cast<size_t>(size.width) * size.height;
+	frame.depth.resize(numPixels);
+	frame.table.resize(numPixels);
+	frame.halfTable.resize(numPixels * 2);
+
+	std::mt19937 rng(size.width * 31 + size.height);
+	std::uniform_int_distribution<int> noise(-20, 20);
+	std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+
+	const float focal = size.width * 0.5f;
+	const float cx = size.width * 0.5f;
+	const float cy = size.height * 0.5f;
+	const float radius = std::max(size.width, size.height) * 0.55f;
+
+	for (int y = 0; y < size.height; ++y)
+	{
+		for (int x = 0; x < size.width; ++x)
+		{
+			const size_t idx = static_cast<size_t>(y) * size.width + x;
+
+			k4a_float2_t val;
+			const float dx = x - cx;
+			const float dy = y - cy;
+			if (std::sqrt(dx * dx + dy * dy) > radius)
+			{
+				val.xy.x = 0.0f;
+				val.xy.y = 0.0f;
+			}
+			else if (chance(rng) < 0.001f)
+			{
+				val.xy.x = std::numeric_limits<float>::quiet_NaN();
+				val.xy.y = 0.5f;
+			}
+			else
+			{
+				val.xy.x = dx / focal;
+				val.xy.y = dy / focal;
+			}
+			frame.table[idx] = val;
+			frame.halfTable[idx * 2] = ofxAzureKinect::floatToHalf(val.xy.x);
+			frame.halfTable[idx * 2 + 1] = ofxAzureKinect::floatToHalf(val.xy.y);
+
+			// Holes come in runs, which is what the compaction has to deal with.
+			const bool bHole = ((x / 7 + y / 5) % 6 == 0) || chance(rng) < 0.05f;
+			frame.depth[idx] = bHole ? 0 : static_cast<uint16_t>(1500 + (x + y) % 2000 + noise(rng));
+		}
+	}
+
+	return frame;
+}
+
+template<typename TableType>
+size_t buildFrame(PointCloudBuilder::Kernel kernel, const TestFrame& frame, const TableType* tableData,
+	std::vector<glm::vec3>& positions, std::vector<glm::vec2>& uvs)
+{
+	return PointCloudBuilder::buildRows(kernel, frame.depth.data(), tableData, frame.width, 0, frame.height, positions.data(), uvs.data());
+}
+
+std::string getKernelName(PointCloudBuilder::Kernel kernel)
+{
+	switch (kernel)
+	{
+	case PointCloudBuilder::KERNEL_SSE41:
+		return "sse4.1";
+	case PointCloudBuilder::KERNEL_AVX2:
+		return "avx2";
+	case PointCloudBuilder::KERNEL_SCALAR:
+	default:
+		return "scalar";
+	}
+}
+
+// Returns false if the kernel's output differs from the scalar output.
+template<typename TableType>
+bool runTable(const std::string& label, const TestFrame& frame, const TableType* tableData, size_t numPasses)
+{
+	const size_t numPixels = frame.depth.size();
+	std::vector<glm::vec3> scalarPositions(numPixels);
+	std::vector<glm::vec2> scalarUvs(numPixels);
+	std::vector<glm::vec3> positions(numPixels);
+	std::vector<glm::vec2> uvs(numPixels);
+
+	const size_t scalarCount = buildFrame(PointCloudBuilder::KERNEL_SCALAR, frame, tableData, scalarPositions, scalarUvs);
+
+	bool bAllMatch = true;
+	double scalarSeconds = 0.0;
+	for (auto kernel : { PointCloudBuilder::KERNEL_SCALAR, PointCloudBuilder::KERNEL_SSE41, PointCloudBuilder::KERNEL_AVX2 })
+	{
+		if (!PointCloudBuilder::isKernelSupported(kernel))
+		{
+			std::cout << std::left << std::setw(16) << label << std::setw(8) << getKernelName(kernel) << "not supported" << std::endl;
+			continue;
+		}
+
+		// Poison the output so that anything the kernel doesn't write shows up.
+		std::fill(positions.begin(), positions.end(), glm::vec3(-1.0f));
+		std::fill(uvs.begin(), uvs.end(), glm::vec2(-1.0f));
+		const size_t count = buildFrame(kernel, frame, tableData, positions, uvs);
+
+		// Compare bits so that NaN positions have to match too.
+		const bool bMatch = count == scalarCount &&
+			std::memcmp(positions.data(), scalarPositions.data(), count * sizeof(glm::vec3)) == 0 &&
+			std::memcmp(uvs.data(), scalarUvs.data(), count * sizeof(glm::vec2)) == 0;
+		bAllMatch &= bMatch;
+
+		double seconds = std::numeric_limits<double>::max();
+		for (size_t pass = 0; pass < numPasses; ++pass)
+		{
+			const auto startTime = std::chrono::steady_clock::now();
+			buildFrame(kernel, frame, tableData, positions, uvs);
+			seconds = std::min(seconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count());
+		}
+		if (kernel == PointCloudBuilder::KERNEL_SCALAR)
+		{
+			scalarSeconds = seconds;
+		}
+
+		std::cout << std::left << std::setw(16) << label << std::setw(8) << getKernelName(kernel)
+			<< std::right << std::setw(10) << std::fixed << std::setprecision(3) << (seconds * 1000.0) << " ms"
+			<< std::setw(8) << std::setprecision(2) << (scalarSeconds / seconds) << "x"
+			<< std::setw(10) << count << " points  "
+			<< (bMatch ? "match" : "MISMATCH") << std::endl;
+	}
+
+	return bAllMatch;
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t numPasses = argc > 1 ? ofToInt(argv[1]) : DEFAULT_NUM_PASSES;
+
+	const std::vector<FrameSize> sizes = {
+		{ "nfov", 640, 576 },
+		{ "wfov", 1024, 1024 },
+		{ "1080p", 1920, 1080 },
+		{ "2160p", 3840, 2160 }
+	};
+
+	std::cout << "Building rows single threaded, best of " << numPasses << " passes, best supported kernel "
+		<< getKernelName(PointCloudBuilder::getBestSupportedKernel()) << std::endl;
+
+	bool bAllMatch = true;
+	for (const auto& size : sizes)
+	{
+		const TestFrame frame = makeFrame(size);
+		bAllMatch &= runTable(size.name + " float", frame, frame.table.data(), numPasses);
+		bAllMatch &= runTable(size.name + " half", frame, frame.halfTable.data(), numPasses);
+	}
+
+	if (!bAllMatch)
+	{
+		std::cout << "SIMD kernels do not match the scalar kernel!" << std::endl;
+		return 1;
+	}
+
+	std::cout << "All kernels match the scalar kernel." << std::endl;
+	return 0;
+}
@@ -0,0 +1,161 @@
+#include "ofMain.h"
+
+#include "ofxAzureKinect.h"
+
+// Times body tracking inference on a recording, on the CPU by default.
+// First runs the tracker one capture at a time and prints the per-frame inference time,
+// then runs a BatchTracker over the whole recording and prints its pipelined throughput.
+// Usage: example-bench-tracker [recording.mkv] [cpu|gpu|cuda|tensorrt|directml] [max frames]
+
+const size_t DEFAULT_MAX_FRAMES = 100;
+
+// The first frames include model loading and warm up.
+const size_t NUM_WARMUP_FRAMES = 5;
+
+const std::chrono::milliseconds POP_TIMEOUT = std::chrono::milliseconds(10000);
+
+bool parseProcessingMode(const std::string& name, ofxAzureKinect::ProcessingMode& mode)
+{
+	if (name == "cpu") mode = K4ABT_TRACKER_PROCESSING_MODE_CPU;
+	else if (name == "gpu") mode = K4ABT_TRACKER_PROCESSING_MODE_GPU;
+	else if (name == "cuda") mode = K4ABT_TRACKER_PROCESSING_MODE_GPU_CUDA;
+	else if (name == "tensorrt") mode = K4ABT_TRACKER_PROCESSING_MODE_GPU_TENSORRT;
+	else if (name == "directml") mode = K4ABT_TRACKER_PROCESSING_MODE_GPU_DIRECTML;
+	else return false;
+	return true;
+}
+
+double getPercentile(std::vector<double> values, double pct)
+{
+	std::sort(values.begin(), values.end());
+	const size_t idx = std::min(values.size() - 1, static_cast<size_t>(pct * values.size()));
+	return values[idx];
+}
+
+// Enqueues one capture at a time and waits for its result, so each time is one inference.
+bool runLockstep(const std::string& filepath, ofxAzureKinect::ProcessingMode mode, size_t maxFrames)
+{
+	std::vector<double> frameMs;
+
+	try
+	{
+		k4a::playback playback = k4a::playback::open(filepath.c_str());
+		const k4a::calibration calibration = playback.get_calibration();
+
+		k4abt_tracker_configuration_t config = K4ABT_TRACKER_CONFIG_DEFAULT;
+		config.processing_mode = mode;
+
+		k4abt::tracker tracker;
+		if (!ofxAzureKinect::BodyTracker::createTracker(calibration, config, false, tracker))
+		{
+			return false;
+		}
+
+		k4a::capture capture;
+		while (frameMs.size() < maxFrames + NUM_WARMUP_FRAMES && playback.get_next_capture(&capture))
+		{
+			// The tracker needs both depth and IR.
+			if (!capture.get_depth_image() || !capture.get_ir_image()) continue;
+
+			const auto startTime = std::chrono::steady_clock::now();
+			if (!tracker.enqueue_capture(capture, POP_TIMEOUT)) continue;
+			k4abt::frame bodyFrame = tracker.pop_result(POP_TIMEOUT);
+			const auto elapsed = std::chrono::steady_clock::now() - startTime;
+
+			if (bodyFrame == nullptr)
+			{
+				ofLogError(__FUNCTION__) << "Timed out waiting for a result!";
+				break;
+			}
+
+			frameMs.push_back(std::chrono::duration<double, std::milli>(elapsed).count());
+		}
+
+		tracker.shutdown();
+		tracker.destroy();
+	}
+	catch (const k4a::error& e)
+	{
+		ofLogError(__FUNCTION__) << e.what();
+		return false;
+	}
+
+	if (frameMs.size() <= NUM_WARMUP_FRAMES)
+	{
+		ofLogError(__FUNCTION__) << "Not enough captures with depth and IR in " << filepath << "!";
+		return false;
+	}
+
+	frameMs.erase(frameMs.begin(), frameMs.begin() + NUM_WARMUP_FRAMES);
+	const double meanMs = std::accumulate(frameMs.begin(), frameMs.end(), 0.0) / frameMs.size();
+
+	std::cout << "Per frame, " << frameMs.size() << " frames after " << NUM_WARMUP_FRAMES << " warm up frames" << std::endl
+		<< std::fixed << std::setprecision(2)
+		<< "  mean " << meanMs << " ms"
+		<< "  p50 " << getPercentile(frameMs, 0.5) << " ms"
+		<< "  p95 " << getPercentile(frameMs, 0.95) << " ms"
+		<< "  max " << getPercentile(frameMs, 1.0) << " ms" << std::endl;
+
+	return true;
+}
+
+// Keeps the tracker queue full over the whole recording.
+bool runBatch(const std::string& filepath, ofxAzureKinect::ProcessingMode mode)
+{
+	ofxAzureKinect::BatchTracker batchTracker;
+
+	auto settings = ofxAzureKinect::BatchTrackerSettings();
+	settings.processingMode = mode;
+	settings.fallbackToCpu = false;
+
+	const std::string outputPath = ofFilePath::join(ofFilePath::getEnclosingDirectory(filepath, false), "bench-tracker.bodies");
+	if (!batchTracker.start(filepath, outputPath, settings)) return false;
+
+	while (batchTracker.isProcessing())
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(500));
+		std::cout << "\r  " << std::fixed << std::setprecision(1) << (batchTracker.getProgress() * 100.0f) << "%" << std::flush;
+	}
+	std::cout << std::endl;
+
+	const bool bFinished = batchTracker.isFinished();
+	const uint64_t numFrames = batchTracker.getNumFramesProcessed();
+	const float fps = batchTracker.getFramesPerSecond();
+	batchTracker.stop();
+
+	ofFile::removeFile(outputPath, false);
+
+	if (!bFinished || fps == 0.0f)
+	{
+		ofLogError(__FUNCTION__) << "Batch tracking did not finish!";
+		return false;
+	}
+
+	std::cout << "Pipelined, " << numFrames << " frames" << std::endl
+		<< std::fixed << std::setprecision(2)
+		<< "  " << fps << " fps, " << (1000.0f / fps) << " ms/frame" << std::endl;
+
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	const std::string filepath = ofToDataPath(argc > 1 ? argv[1] : "recording.mkv", true);
+	const std::string modeName = argc > 2 ? argv[2] : "cpu";
+	const size_t maxFrames = argc > 3 ? ofToInt(argv[3]) : DEFAULT_MAX_FRAMES;
+
+	ofxAzureKinect::ProcessingMode mode;
+	if (!parseProcessingMode(modeName, mode))
+	{
+		ofLogError(__FUNCTION__) << "Unknown processing mode " << modeName << "!";
+		return 1;
+	}
+
+	std::cout << "Tracking " << filepath << " in " << modeName << " mode, "
+		<< std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+
+	if (!runLockstep(filepath, mode, maxFrames)) return 1;
+	if (!runBatch(filepath, mode)) return 1;
+
+	return 0;
+}
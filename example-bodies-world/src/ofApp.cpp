@@ -1,5 +1,12 @@
 #include "ofApp.h"
 
+// Only track every other capture, the skeletons in between are interpolated from the tracker history.
+const size_t TRACK_EVERY_NTH_CAPTURE = 2;
+
+// Sample this far behind the latest result, at least the time between two results at 30 fps,
+// so that skeletons are interpolated instead of extrapolated.
+const std::chrono::microseconds SAMPLE_DELAY = std::chrono::microseconds(1000000 / 30 * TRACK_EVERY_NTH_CAPTURE);
+
 //--------------------------------------------------------------
 void ofApp::setup()
 {
@@ -22,6 +29,7 @@ void ofApp::setup()
 		auto bodyTrackerSettings = ofxAzureKinect::BodyTrackerSettings();
 		bodyTrackerSettings.sensorOrientation = K4ABT_SENSOR_ORIENTATION_DEFAULT;
 		//bodyTrackerSettings.processingMode = K4ABT_TRACKER_PROCESSING_MODE_CPU;
+		bodyTrackerSettings.trackEveryNthCapture = TRACK_EVERY_NTH_CAPTURE;
 		kinectDevice.startBodyTracker(bodyTrackerSettings);
 	}
 
@@ -50,7 +58,12 @@ void ofApp::exit()
 //--------------------------------------------------------------
 void ofApp::update()
 {
-
+	// getBodySkeletons() only has the tracked captures, sample the history for smooth skeletons every frame.
+	const auto& bodyTracker = kinectDevice.getBodyTracker();
+	if (bodyTracker.isTracking())
+	{
+		bodyTracker.sampleBodies(bodyTracker.getEstimatedTimestamp() - SAMPLE_DELAY, bodySkeletons);
+	}
 }
 
 //--------------------------------------------------------------
@@ -66,8 +79,6 @@ void ofApp::draw()
 
 			ofEnableDepthTest();
 
-			const auto& bodySkeletons = kinectDevice.getBodySkeletons();
-
 			constexpr int kMaxBodies = 6;
 			int bodyIDs[kMaxBodies];
 			int i = 0;
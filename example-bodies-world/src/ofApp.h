@@ -35,4 +35,6 @@ private:
 	ofShader shader;
 
 	ofVboMesh skeletonMesh;
+
+	std::vector<ofxAzureKinect::BodySkeleton> bodySkeletons;
 };
@@ -0,0 +1,260 @@
+#include "ofMain.h"
+
+#include "ofxAzureKinect.h"
+
+// Counts the heap allocations BodyTracker::processResult() makes once it is warmed up, in depth
+// and color space, by running the same recorded results through it over and over.
+// Counts operator new, and the image buffers the Sensor SDK allocates through k4a_set_allocator(),
+// like the ones the transformation creates when it isn't given output images.
+// Exits with 1 if any steady state call allocates.
+// Usage: example-test-allocations [recording.mkv] [cpu|gpu|cuda|tensorrt|directml]
+
+const size_t NUM_FRAMES = 8;
+
+// Enough passes for every result to have gone through every slot of the frame buffer.
+const size_t NUM_WARMUP_PASSES = 3;
+const size_t NUM_PASSES = 10;
+
+const std::chrono::milliseconds POP_TIMEOUT = std::chrono::milliseconds(10000);
+
+std::atomic<size_t> numAllocations(0);
+std::atomic<size_t> numImageAllocations(0);
+thread_local bool bCountAllocations = false;
+
+void* operator new(std::size_t size)
+{
+	if (bCountAllocations)
+	{
+		++numAllocations;
+	}
+
+	void* ptr = std::malloc(size ? size : 1);
+	if (!ptr) throw std::bad_alloc();
+	return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t /*size*/) noexcept
+{
+	std::free(ptr);
+}
+
+uint8_t* allocateImage(int size, void** context)
+{
+	if (bCountAllocations)
+	{
+		++numImageAllocations;
+	}
+
+	*context = nullptr;
+	return static_cast<uint8_t*>(std::malloc(size));
+}
+
+void freeImage(void* buffer, void* /*context*/)
+{
+	std::free(buffer);
+}
+
+// Lets us feed results in without going through the tracker thread.
+class ResultTracker
+	: public ofxAzureKinect::BodyTracker
+{
+public:
+	using BodyTracker::processResult;
+};
+
+bool parseProcessingMode(const std::string& name, ofxAzureKinect::ProcessingMode& mode)
+{
+	if (name == "cpu") mode = K4ABT_TRACKER_PROCESSING_MODE_CPU;
+	else if (name == "gpu") mode = K4ABT_TRACKER_PROCESSING_MODE_GPU;
+	else if (name == "cuda") mode = K4ABT_TRACKER_PROCESSING_MODE_GPU_CUDA;
+	else if (name == "tensorrt") mode = K4ABT_TRACKER_PROCESSING_MODE_GPU_TENSORRT;
+	else if (name == "directml") mode = K4ABT_TRACKER_PROCESSING_MODE_GPU_DIRECTML;
+	else return false;
+	return true;
+}
+
+// Tracks the first captures of the recording and keeps their results.
+bool popResults(const std::string& filepath, const k4a::calibration& calibration, ofxAzureKinect::ProcessingMode mode,
+	k4abt::tracker& tracker, std::vector<k4abt::frame>& bodyFrames)
+{
+	try
+	{
+		k4a::playback playback = k4a::playback::open(filepath.c_str());
+
+		k4abt_tracker_configuration_t config = K4ABT_TRACKER_CONFIG_DEFAULT;
+		config.processing_mode = mode;
+		if (!ofxAzureKinect::BodyTracker::createTracker(calibration, config, false, tracker))
+		{
+			return false;
+		}
+
+		k4a::capture capture;
+		while (bodyFrames.size() < NUM_FRAMES && playback.get_next_capture(&capture))
+		{
+			// The tracker needs both depth and IR.
+			if (!capture.get_depth_image() || !capture.get_ir_image()) continue;
+
+			if (!tracker.enqueue_capture(capture, POP_TIMEOUT)) continue;
+			k4abt::frame bodyFrame = tracker.pop_result(POP_TIMEOUT);
+			if (bodyFrame == nullptr)
+			{
+				ofLogError(__FUNCTION__) << "Timed out waiting for a result!";
+				return false;
+			}
+
+			bodyFrames.push_back(std::move(bodyFrame));
+		}
+	}
+	catch (const k4a::error& e)
+	{
+		ofLogError(__FUNCTION__) << e.what();
+		return false;
+	}
+
+	if (bodyFrames.size() < NUM_FRAMES)
+	{
+		ofLogError(__FUNCTION__) << "Not enough captures with depth and IR in " << filepath << "!";
+		return false;
+	}
+
+	return true;
+}
+
+// Returns false if a processResult() call allocated after the warm up passes.
+bool runImageType(const std::string& label, const k4a::calibration& calibration, ofxAzureKinect::ProcessingMode mode,
+	k4a_calibration_type_t imageType, const std::vector<k4abt::frame>& bodyFrames)
+{
+	ResultTracker tracker;
+
+	auto settings = ofxAzureKinect::BodyTrackerSettings();
+	settings.processingMode = mode;
+	settings.fallbackToCpu = false;
+	settings.imageType = imageType;
+	settings.updateBodyIndex = true;
+	settings.updateBodiesWorld = true;
+	settings.updateBodiesImage = true;
+	settings.filterJoints = true;
+	if (!tracker.startTracking(calibration, settings)) return false;
+
+	size_t numCalls = 0;
+	size_t numAllocatingCalls = 0;
+	size_t numCounted = 0;
+	size_t numImagesCounted = 0;
+	for (size_t pass = 0; pass < NUM_WARMUP_PASSES + NUM_PASSES; ++pass)
+	{
+		const bool bCount = pass >= NUM_WARMUP_PASSES;
+		for (const auto& bodyFrame : bodyFrames)
+		{
+			// processResult() releases the frame it is given.
+			k4abt::frame frame = bodyFrame;
+
+			const size_t numBefore = numAllocations;
+			const size_t numImagesBefore = numImageAllocations;
+			bCountAllocations = bCount;
+			tracker.processResult(frame);
+			bCountAllocations = false;
+
+			if (!bCount) continue;
+
+			const size_t numCallAllocations = numAllocations - numBefore;
+			const size_t numCallImageAllocations = numImageAllocations - numImagesBefore;
+			++numCalls;
+			numCounted += numCallAllocations;
+			numImagesCounted += numCallImageAllocations;
+			if (numCallAllocations > 0 || numCallImageAllocations > 0)
+			{
+				++numAllocatingCalls;
+			}
+		}
+	}
+
+	tracker.stopTracking();
+
+	const bool bPass = numCounted == 0 && numImagesCounted == 0;
+	std::cout << std::left << std::setw(8) << label
+		<< std::right << std::setw(6) << numCalls << " calls"
+		<< std::setw(8) << numCounted << " allocations"
+		<< std::setw(6) << numImagesCounted << " image buffers"
+		<< std::setw(6) << numAllocatingCalls << " allocating calls  "
+		<< (bPass ? "pass" : "FAIL") << std::endl;
+
+	return bPass;
+}
+
+int main(int argc, char* argv[])
+{
+	const std::string filepath = ofToDataPath(argc > 1 ? argv[1] : "recording.mkv", true);
+	const std::string modeName = argc > 2 ? argv[2] : "cpu";
+
+	ofxAzureKinect::ProcessingMode mode;
+	if (!parseProcessingMode(modeName, mode))
+	{
+		ofLogError(__FUNCTION__) << "Unknown processing mode " << modeName << "!";
+		return 1;
+	}
+
+	// Before any image is created, so that every image buffer goes through it.
+	if (K4A_FAILED(k4a_set_allocator(allocateImage, freeImage)))
+	{
+		ofLogError(__FUNCTION__) << "Could not set the image allocator!";
+		return 1;
+	}
+
+	k4a::calibration calibration;
+	bool bHasColor = false;
+	try
+	{
+		k4a::playback playback = k4a::playback::open(filepath.c_str());
+		calibration = playback.get_calibration();
+		bHasColor = playback.get_record_configuration().color_resolution != K4A_COLOR_RESOLUTION_OFF;
+	}
+	catch (const k4a::error& e)
+	{
+		ofLogError(__FUNCTION__) << e.what();
+		return 1;
+	}
+
+	k4abt::tracker tracker;
+	std::vector<k4abt::frame> bodyFrames;
+	const bool bPopped = popResults(filepath, calibration, mode, tracker, bodyFrames);
+	bool bAllPass = true;
+	if (bPopped)
+	{
+		std::cout << "Processing " << bodyFrames.size() << " results from " << filepath << " " << NUM_PASSES << " times after "
+			<< NUM_WARMUP_PASSES << " warm up passes" << std::endl;
+
+		bAllPass &= runImageType("depth", calibration, mode, K4A_CALIBRATION_TYPE_DEPTH, bodyFrames);
+		if (bHasColor)
+		{
+			bAllPass &= runImageType("color", calibration, mode, K4A_CALIBRATION_TYPE_COLOR, bodyFrames);
+		}
+		else
+		{
+			std::cout << "No color in " << filepath << ", skipping color space." << std::endl;
+		}
+	}
+
+	// Give the results back before the tracker goes away.
+	bodyFrames.clear();
+	if (tracker)
+	{
+		tracker.shutdown();
+		tracker.destroy();
+	}
+
+	if (!bPopped) return 1;
+
+	if (!bAllPass)
+	{
+		std::cout << "processResult() allocates in steady state!" << std::endl;
+		return 1;
+	}
+
+	std::cout << "processResult() does not allocate in steady state." << std::endl;
+	return 0;
+}
@@ -0,0 +1,241 @@
+#include "ofMain.h"
+
+#include "ofxAzureKinect.h"
+#include "ofxAzureKinect/CameraModel.h"
+#include "ofxAzureKinect/WorkerPool.h"
+
+// Checks the world tables generated by CameraModel against convert_2d_to_3d on every pixel,
+// for every depth mode and color resolution of the saved calibrations in data/calibrations.
+// Recordings passed on the command line are checked too, and their calibration is saved
+// next to the others so that later runs keep covering that device. No device is needed.
+// Exits with 1 if any table is off by more than CameraModel::TABLE_TOLERANCE, or if more
+// than 0.5% of its pixels disagree on validity.
+// Usage: example-test-camera-model [recording.mkv ...]
+
+using ofxAzureKinect::CameraModel;
+using ofxAzureKinect::WorkerPool;
+
+const std::string CALIBRATIONS_DIR = "calibrations";
+
+// Validity can flip on pixels right on the edge of the valid area, up to 1 in 200.
+const size_t MAX_VALIDITY_MISMATCH_RATIO = 200;
+
+const std::vector<k4a_depth_mode_t> DEPTH_MODES = {
+	K4A_DEPTH_MODE_NFOV_2X2BINNED,
+	K4A_DEPTH_MODE_NFOV_UNBINNED,
+	K4A_DEPTH_MODE_WFOV_2X2BINNED,
+	K4A_DEPTH_MODE_WFOV_UNBINNED,
+	K4A_DEPTH_MODE_PASSIVE_IR
+};
+
+const std::vector<k4a_color_resolution_t> COLOR_RESOLUTIONS = {
+	K4A_COLOR_RESOLUTION_720P,
+	K4A_COLOR_RESOLUTION_1080P,
+	K4A_COLOR_RESOLUTION_1440P,
+	K4A_COLOR_RESOLUTION_1536P,
+	K4A_COLOR_RESOLUTION_2160P,
+	K4A_COLOR_RESOLUTION_3072P
+};
+
+struct Band
+{
+	float maxError;
+	size_t numMismatches;
+};
+
+std::vector<uint8_t> readCalibration(const std::string& path)
+{
+	std::vector<uint8_t> raw;
+
+	if (ofFilePath::getFileExt(path) == "mkv")
+	{
+		try
+		{
+			k4a::playback playback = k4a::playback::open(path.c_str());
+			raw = playback.get_raw_calibration();
+		}
+		catch (const k4a::error& e)
+		{
+			ofLogError(__FUNCTION__) << e.what();
+			return raw;
+		}
+
+		// Keep it for later runs.
+		const std::string savePath = ofToDataPath(ofFilePath::join(CALIBRATIONS_DIR, ofFilePath::getBaseName(path) + ".json"), true);
+		if (!ofFile::doesFileExist(savePath, false))
+		{
+			std::ofstream ofs(savePath, std::ios::binary);
+			ofs.write(reinterpret_cast<const char*>(raw.data()), raw.size());
+			std::cout << "Saved the calibration of " << path << " to " << savePath << std::endl;
+		}
+	}
+	else
+	{
+		std::ifstream ifs(path, std::ios::binary);
+		raw.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+	}
+
+	// The SDK parses the blob as a string.
+	if (!raw.empty() && raw.back() != 0)
+	{
+		raw.push_back(0);
+	}
+
+	return raw;
+}
+
+// Returns false if the camera model's table does not match the SDK's.
+bool checkTable(const std::string& label, const k4a::calibration& calibration, k4a_calibration_type_t type, WorkerPool& workerPool)
+{
+	const k4a_calibration_camera_t& camera = (type == K4A_CALIBRATION_TYPE_DEPTH) ? calibration.depth_camera_calibration : calibration.color_camera_calibration;
+	const int width = camera.resolution_width;
+	const int height = camera.resolution_height;
+
+	const CameraModel cameraModel(camera);
+	if (!cameraModel.isSupported())
+	{
+		std::cout << std::left << std::setw(36) << label << "unsupported lens model " << camera.intrinsics.type << std::endl;
+		return false;
+	}
+
+	std::vector<k4a_float2_t> table(static_cast<size_t>(width) * height);
+	std::vector<Band> bands(std::min(workerPool.getNumThreads() * 4, static_cast<size_t>(height)));
+	const auto getBandRows = [&](size_t i)
+	{
+		return glm::ivec2(height * i / bands.size(), height * (i + 1) / bands.size());
+	};
+
+	workerPool.run(bands.size(), [&](size_t i)
+	{
+		const auto rows = getBandRows(i);
+		cameraModel.unprojectRows(rows.x, rows.y, table.data());
+
+		Band& band = bands[i];
+		band.maxError = 0.f;
+		band.numMismatches = 0;
+
+		k4a_float2_t p;
+		k4a_float3_t ray;
+		for (int y = rows.x; y < rows.y; ++y)
+		{
+			p.xy.y = static_cast<float>(y);
+
+			for (int x = 0; x < width; ++x)
+			{
+				p.xy.x = static_cast<float>(x);
+
+				const k4a_float2_t& val = table[static_cast<size_t>(y) * width + x];
+				const bool bValid = val.xy.x != 0 || val.xy.y != 0;
+				bool bSdkValid = false;
+				try
+				{
+					bSdkValid = calibration.convert_2d_to_3d(p, 1.f, type, type, &ray);
+				}
+				catch (const k4a::error& e)
+				{
+					ofLogError(__FUNCTION__) << e.what();
+				}
+
+				if (bValid != bSdkValid)
+				{
+					++band.numMismatches;
+				}
+				else if (bValid)
+				{
+					band.maxError = std::max(band.maxError, std::max(std::abs(val.xy.x - ray.xyz.x), std::abs(val.xy.y - ray.xyz.y)));
+				}
+			}
+		}
+	});
+
+	float maxError = 0.f;
+	size_t numMismatches = 0;
+	for (const auto& band : bands)
+	{
+		maxError = std::max(maxError, band.maxError);
+		numMismatches += band.numMismatches;
+	}
+
+	const size_t numPixels = table.size();
+	const bool bPass = maxError <= CameraModel::TABLE_TOLERANCE && numMismatches * MAX_VALIDITY_MISMATCH_RATIO <= numPixels;
+
+	std::cout << std::left << std::setw(36) << label
+		<< std::right << std::setw(6) << width << "x" << std::left << std::setw(6) << height
+		<< std::right << "  max error " << std::scientific << std::setprecision(2) << maxError
+		<< "  validity mismatches " << std::fixed << std::setprecision(3) << (100.0 * numMismatches / numPixels) << "%  "
+		<< (bPass ? "pass" : "FAIL") << std::endl;
+
+	return bPass;
+}
+
+int main(int argc, char* argv[])
+{
+	std::vector<std::string> paths;
+
+	ofDirectory dir(ofToDataPath(CALIBRATIONS_DIR, true));
+	dir.allowExt("json");
+	dir.listDir();
+	dir.sort();
+	for (size_t i = 0; i < dir.size(); ++i)
+	{
+		paths.push_back(dir.getPath(i));
+	}
+
+	for (int i = 1; i < argc; ++i)
+	{
+		paths.push_back(ofToDataPath(argv[i], true));
+	}
+
+	if (paths.empty())
+	{
+		ofLogError(__FUNCTION__) << "No calibrations to check, add some to " << dir.getAbsolutePath() << "!";
+		return 1;
+	}
+
+	WorkerPool workerPool;
+	workerPool.setup(std::max(std::thread::hardware_concurrency(), 1u));
+
+	bool bAllPass = true;
+	for (const auto& path : paths)
+	{
+		std::vector<uint8_t> raw = readCalibration(path);
+		if (raw.empty())
+		{
+			ofLogError(__FUNCTION__) << "Could not read a calibration from " << path << "!";
+			bAllPass = false;
+			continue;
+		}
+
+		const std::string name = ofFilePath::getFileName(path);
+
+		try
+		{
+			// The depth table only depends on the depth mode, and the color table on the color resolution.
+			for (auto depthMode : DEPTH_MODES)
+			{
+				const auto calibration = k4a::calibration::get_from_raw(raw, depthMode, COLOR_RESOLUTIONS.front());
+				bAllPass &= checkTable(name + " depth mode " + ofToString(depthMode), calibration, K4A_CALIBRATION_TYPE_DEPTH, workerPool);
+			}
+
+			for (auto colorResolution : COLOR_RESOLUTIONS)
+			{
+				const auto calibration = k4a::calibration::get_from_raw(raw, DEPTH_MODES.front(), colorResolution);
+				bAllPass &= checkTable(name + " color resolution " + ofToString(colorResolution), calibration, K4A_CALIBRATION_TYPE_COLOR, workerPool);
+			}
+		}
+		catch (const k4a::error& e)
+		{
+			ofLogError(__FUNCTION__) << name << ": " << e.what();
+			bAllPass = false;
+		}
+	}
+
+	if (!bAllPass)
+	{
+		std::cout << "The camera model does not match the SDK!" << std::endl;
+		return 1;
+	}
+
+	std::cout << "The camera model matches the SDK." << std::endl;
+	return 0;
+}
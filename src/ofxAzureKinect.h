@@ -1,7 +1,18 @@
 #pragma once
 
+#include "ofxAzureKinect/BatchTracker.h"
+#include "ofxAzureKinect/BodySerializer.h"
+#include "ofxAzureKinect/BodySkeleton.h"
 #include "ofxAzureKinect/BodyTracker.h"
 #include "ofxAzureKinect/Device.h"
+#include "ofxAzureKinect/Frame.h"
+#include "ofxAzureKinect/JointFilter.h"
 #include "ofxAzureKinect/Playback.h"
+#include "ofxAzureKinect/PlaybackGroup.h"
+#include "ofxAzureKinect/PlaybackIndex.h"
+#include "ofxAzureKinect/PlaybackReader.h"
+#include "ofxAzureKinect/PointCloudBuilder.h"
+#include "ofxAzureKinect/PointProjector.h"
 #include "ofxAzureKinect/Recorder.h"
+#include "ofxAzureKinect/SkeletonHistory.h"
 #include "ofxAzureKinect/Types.h"
@@ -0,0 +1,273 @@
+#include "BatchTracker.h"
+
+#include "ofUtils.h"
+
+#include "BodySerializer.h"
+
+const int32_t POP_TIMEOUT_IN_MS = 1000;
+
+namespace ofxAzureKinect
+{
+	BatchTrackerSettings::BatchTrackerSettings()
+		: sensorOrientation(K4ABT_SENSOR_ORIENTATION_DEFAULT)
+		, processingMode(K4ABT_TRACKER_PROCESSING_MODE_GPU)
+		, gpuDeviceID(0)
+		, fallbackToCpu(true)
+		, modelPath("")
+		, writeBodyIndex(false)
+	{}
+
+	BatchTracker::BatchTracker()
+		: bWriteBodyIndex(false)
+		, duration(0)
+		, startTimestamp(0)
+		, trackerConfig(K4ABT_TRACKER_CONFIG_DEFAULT)
+		, bFinished(false)
+		, lastTimestampUsec(0)
+		, numFramesProcessed(0)
+		, elapsedUsec(0)
+	{}
+
+	BatchTracker::~BatchTracker()
+	{
+		this->stop();
+	}
+
+	bool BatchTracker::start(const std::string& inputPath, const std::string& outputPath, BatchTrackerSettings settings)
+	{
+		if (this->isThreadRunning())
+		{
+			ofLogError(__FUNCTION__) << "Already processing, stop first!";
+			return false;
+		}
+
+		// Clean up after a previous run.
+		this->stop();
+
+		k4a::calibration calibration;
+		try
+		{
+			this->playback = k4a::playback::open(ofToDataPath(inputPath, true).c_str());
+			calibration = this->playback.get_calibration();
+			this->duration = this->playback.get_recording_length();
+			this->startTimestamp = std::chrono::microseconds(this->playback.get_record_configuration().start_timestamp_offset_usec);
+		}
+		catch (const k4a::error& e)
+		{
+			ofLogError(__FUNCTION__) << e.what();
+			this->playback.close();
+			return false;
+		}
+
+		this->trackerConfig = K4ABT_TRACKER_CONFIG_DEFAULT;
+		this->trackerConfig.processing_mode = settings.processingMode;
+		this->trackerConfig.sensor_orientation = settings.sensorOrientation;
+		this->trackerConfig.gpu_device_id = settings.gpuDeviceID;
+
+		this->modelPath = settings.modelPath.empty() ? "" : ofToDataPath(settings.modelPath, true);
+		if (!this->modelPath.empty())
+		{
+			this->trackerConfig.model_path = this->modelPath.c_str();
+		}
+
+		if (!BodyTracker::createTracker(calibration, this->trackerConfig, settings.fallbackToCpu, this->bodyTracker))
+		{
+			this->playback.close();
+			return false;
+		}
+
+		this->bWriteBodyIndex = settings.writeBodyIndex;
+
+		const std::string outputFilePath = ofToDataPath(outputPath, true);
+		this->outputStream.open(outputFilePath, std::ios::binary | std::ios::trunc);
+		if (!this->outputStream || !BodySerializer::writeHeader(this->outputStream, this->bWriteBodyIndex))
+		{
+			ofLogError(__FUNCTION__) << "Could not open " << outputFilePath << " for writing!";
+			this->outputStream.close();
+			this->bodyTracker.destroy();
+			this->playback.close();
+			return false;
+		}
+
+		this->bFinished = false;
+		this->lastTimestampUsec = 0;
+		this->numFramesProcessed = 0;
+		this->elapsedUsec = 0;
+		this->startTime = std::chrono::steady_clock::now();
+
+		ofLogNotice(__FUNCTION__) << "Processing " << inputPath << " to " << outputFilePath;
+
+		this->startThread();
+
+		return true;
+	}
+
+	bool BatchTracker::stop()
+	{
+		if (!this->bodyTracker) return false;
+
+		this->stopThread();
+		this->bodyTracker.shutdown();
+		this->waitForThread(false);
+
+		this->outputStream.close();
+		this->bodyTracker.destroy();
+		this->playback.close();
+
+		return true;
+	}
+
+	bool BatchTracker::isProcessing() const
+	{
+		return this->isThreadRunning();
+	}
+
+	bool BatchTracker::isFinished() const
+	{
+		return this->bFinished;
+	}
+
+	float BatchTracker::getProgress() const
+	{
+		if (this->duration.count() == 0) return 0.0f;
+		// Device timestamps start at the recording's start offset.
+		return ofClamp(static_cast<float>(this->lastTimestampUsec - this->startTimestamp.count()) / this->duration.count(), 0.0f, 1.0f);
+	}
+
+	uint64_t BatchTracker::getNumFramesProcessed() const
+	{
+		return this->numFramesProcessed;
+	}
+
+	float BatchTracker::getFramesPerSecond() const
+	{
+		if (this->elapsedUsec == 0) return 0.0f;
+		return this->numFramesProcessed * 1000000.0f / this->elapsedUsec;
+	}
+
+	ProcessingMode BatchTracker::getProcessingMode() const
+	{
+		return this->trackerConfig.processing_mode;
+	}
+
+	void BatchTracker::threadedFunction()
+	{
+		k4a::capture capture;
+		size_t numQueued = 0;
+		bool bEndOfFile = false;
+
+		while (this->isThreadRunning())
+		{
+			try
+			{
+				// Keep the tracker queue full, only waiting on results once it takes no more captures.
+				if (!bEndOfFile)
+				{
+					if (!capture)
+					{
+						if (!this->playback.get_next_capture(&capture))
+						{
+							bEndOfFile = true;
+						}
+						else if (!capture.get_depth_image() || !capture.get_ir_image())
+						{
+							// The tracker needs both depth and IR.
+							capture.reset();
+							continue;
+						}
+					}
+
+					if (capture && this->bodyTracker.enqueue_capture(capture, std::chrono::milliseconds(0)))
+					{
+						capture.reset();
+						++numQueued;
+						continue;
+					}
+				}
+
+				if (numQueued == 0)
+				{
+					if (bEndOfFile) break;
+					continue;
+				}
+
+				k4abt::frame bodyFrame = this->bodyTracker.pop_result(std::chrono::milliseconds(POP_TIMEOUT_IN_MS));
+				if (bodyFrame == nullptr) continue;
+
+				--numQueued;
+				if (!this->writeResult(bodyFrame))
+				{
+					break;
+				}
+			}
+			catch (const k4a::error& e)
+			{
+				if (this->isThreadRunning())
+				{
+					ofLogError(__FUNCTION__) << e.what();
+				}
+				break;
+			}
+		}
+
+		this->outputStream.flush();
+
+		if (bEndOfFile && numQueued == 0)
+		{
+			ofLogNotice(__FUNCTION__) << "Finished processing " << this->numFramesProcessed << " frames at " << this->getFramesPerSecond() << " fps.";
+			this->bFinished = true;
+		}
+	}
+
+	bool BatchTracker::writeResult(k4abt::frame& bodyFrame)
+	{
+		this->bodyFrame.timestamp = bodyFrame.get_device_timestamp();
+
+		const size_t numBodies = bodyFrame.get_num_bodies();
+		this->bodyFrame.bodySkeletons.resize(numBodies);
+		for (size_t i = 0; i < numBodies; ++i)
+		{
+			const k4abt_skeleton_t skeleton = bodyFrame.get_body_skeleton(i);
+
+			BodySkeleton& bodySkeleton = this->bodyFrame.bodySkeletons[i];
+			bodySkeleton.id = bodyFrame.get_body_id(i);
+			for (size_t j = 0; j < K4ABT_JOINT_COUNT; ++j)
+			{
+				bodySkeleton.joints[j].position = toGlm(skeleton.joints[j].position);
+				bodySkeleton.joints[j].orientation = toGlm(skeleton.joints[j].orientation);
+				bodySkeleton.joints[j].confidenceLevel = skeleton.joints[j].confidence_level;
+			}
+		}
+
+		if (this->bWriteBodyIndex)
+		{
+			const k4a::image bodyIndexImg = bodyFrame.get_body_index_map();
+			if (bodyIndexImg)
+			{
+				const int width = bodyIndexImg.get_width_pixels();
+				const int height = bodyIndexImg.get_height_pixels();
+				if (!this->bodyFrame.bodyIndexPix.isAllocated())
+				{
+					this->bodyFrame.bodyIndexPix.allocate(width, height, 1);
+				}
+				this->bodyFrame.bodyIndexPix.setFromPixels(bodyIndexImg.get_buffer(), width, height, 1);
+			}
+			else
+			{
+				this->bodyFrame.bodyIndexPix.clear();
+			}
+		}
+
+		if (!BodySerializer::writeFrame(this->outputStream, this->bodyFrame, this->bWriteBodyIndex))
+		{
+			ofLogError(__FUNCTION__) << "Failed writing frame, stopping.";
+			return false;
+		}
+
+		this->lastTimestampUsec = this->bodyFrame.timestamp.count();
+		++this->numFramesProcessed;
+		this->elapsedUsec = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - this->startTime).count();
+
+		return true;
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <string>
+
+#include <k4a/k4a.hpp>
+#include <k4abt.hpp>
+#include <k4arecord/playback.hpp>
+
+#include "ofThread.h"
+
+#include "BodyTracker.h"
+#include "Types.h"
+
+namespace ofxAzureKinect
+{
+	struct BatchTrackerSettings
+	{
+		SensorOrientation sensorOrientation;
+		ProcessingMode processingMode;
+		int32_t gpuDeviceID;
+		bool fallbackToCpu;
+		std::string modelPath;
+
+		// Also write the depth sized body index map for every frame.
+		bool writeBodyIndex;
+
+		BatchTrackerSettings();
+	};
+
+	// Runs body tracking over a whole recording as fast as the tracker allows,
+	// and writes the results for every frame to a file (see BodySerializer for the format).
+	class BatchTracker
+		: public ofThread
+	{
+	public:
+		BatchTracker();
+		~BatchTracker();
+
+		bool start(const std::string& inputPath, const std::string& outputPath, BatchTrackerSettings settings = BatchTrackerSettings());
+		bool stop();
+
+		bool isProcessing() const;
+		bool isFinished() const;
+
+		float getProgress() const;
+		uint64_t getNumFramesProcessed() const;
+		float getFramesPerSecond() const;
+
+		ProcessingMode getProcessingMode() const;
+
+	protected:
+		void threadedFunction() override;
+
+		bool writeResult(k4abt::frame& bodyFrame);
+
+	private:
+		bool bWriteBodyIndex;
+
+		k4a::playback playback;
+		std::chrono::microseconds duration;
+		std::chrono::microseconds startTimestamp;
+
+		k4abt_tracker_configuration_t trackerConfig;
+		std::string modelPath;
+		k4abt::tracker bodyTracker;
+
+		std::ofstream outputStream;
+
+		std::atomic<bool> bFinished;
+		std::atomic<int64_t> lastTimestampUsec;
+		std::atomic<uint64_t> numFramesProcessed;
+		std::chrono::steady_clock::time_point startTime;
+		std::atomic<int64_t> elapsedUsec;
+
+		BodyFrame bodyFrame;
+	};
+}
@@ -0,0 +1,211 @@
+#include "BodySerializer.h"
+
+#include <cstring>
+
+#include "ofLog.h"
+
+namespace
+{
+	const char FILE_MAGIC[8] = { 'K', '4', 'A', 'B', 'T', 'S', 'K', 'L' };
+
+	const size_t JOINT_BYTES = 3 * sizeof(float) + 4 * sizeof(float) + sizeof(uint32_t);
+	const size_t BODY_BYTES = sizeof(uint32_t) + K4ABT_JOINT_COUNT * JOINT_BYTES;
+
+	// Everything we target is little-endian, so values are copied as is.
+	template<typename T>
+	void append(std::vector<uint8_t>& data, T value)
+	{
+		const size_t offset = data.size();
+		data.resize(offset + sizeof(T));
+		std::memcpy(data.data() + offset, &value, sizeof(T));
+	}
+
+	template<typename T>
+	T extract(const uint8_t* data, size_t& offset)
+	{
+		T value;
+		std::memcpy(&value, data + offset, sizeof(T));
+		offset += sizeof(T);
+		return value;
+	}
+
+	template<typename T>
+	bool writeValue(std::ostream& os, T value)
+	{
+		os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+		return static_cast<bool>(os);
+	}
+
+	template<typename T>
+	bool readValue(std::istream& is, T& value)
+	{
+		is.read(reinterpret_cast<char*>(&value), sizeof(T));
+		return static_cast<bool>(is);
+	}
+}
+
+namespace ofxAzureKinect
+{
+	const uint32_t BodySerializer::VERSION = 1;
+	const uint32_t BodySerializer::FLAG_BODY_INDEX = 0x1;
+
+	void BodySerializer::writeSkeletons(const std::vector<BodySkeleton>& skeletons, std::vector<uint8_t>& data)
+	{
+		data.reserve(data.size() + sizeof(uint32_t) + skeletons.size() * BODY_BYTES);
+
+		append<uint32_t>(data, static_cast<uint32_t>(skeletons.size()));
+		for (const auto& skeleton : skeletons)
+		{
+			append<uint32_t>(data, skeleton.id);
+			for (const auto& joint : skeleton.joints)
+			{
+				append<float>(data, joint.position.x);
+				append<float>(data, joint.position.y);
+				append<float>(data, joint.position.z);
+				append<float>(data, joint.orientation.w);
+				append<float>(data, joint.orientation.x);
+				append<float>(data, joint.orientation.y);
+				append<float>(data, joint.orientation.z);
+				append<uint32_t>(data, static_cast<uint32_t>(joint.confidenceLevel));
+			}
+		}
+	}
+
+	bool BodySerializer::readSkeletons(const uint8_t* data, size_t size, std::vector<BodySkeleton>& skeletons)
+	{
+		if (size < sizeof(uint32_t))
+		{
+			ofLogError(__FUNCTION__) << "Skeleton block too small!";
+			return false;
+		}
+
+		size_t offset = 0;
+		const uint32_t numBodies = extract<uint32_t>(data, offset);
+		if (size < sizeof(uint32_t) + numBodies * BODY_BYTES)
+		{
+			ofLogError(__FUNCTION__) << "Skeleton block truncated, expected " << numBodies << " bodies.";
+			return false;
+		}
+
+		skeletons.resize(numBodies);
+		for (auto& skeleton : skeletons)
+		{
+			skeleton.id = extract<uint32_t>(data, offset);
+			for (auto& joint : skeleton.joints)
+			{
+				joint.position.x = extract<float>(data, offset);
+				joint.position.y = extract<float>(data, offset);
+				joint.position.z = extract<float>(data, offset);
+				joint.orientation.w = extract<float>(data, offset);
+				joint.orientation.x = extract<float>(data, offset);
+				joint.orientation.y = extract<float>(data, offset);
+				joint.orientation.z = extract<float>(data, offset);
+				joint.confidenceLevel = static_cast<ConfidenceLevel>(extract<uint32_t>(data, offset));
+				joint.projPos = glm::vec2(0);
+			}
+		}
+
+		return true;
+	}
+
+	bool BodySerializer::writeHeader(std::ostream& os, bool bodyIndex)
+	{
+		os.write(FILE_MAGIC, sizeof(FILE_MAGIC));
+		writeValue<uint32_t>(os, VERSION);
+		writeValue<uint32_t>(os, K4ABT_JOINT_COUNT);
+		writeValue<uint32_t>(os, bodyIndex ? FLAG_BODY_INDEX : 0);
+		return writeValue<uint32_t>(os, 0);
+	}
+
+	bool BodySerializer::readHeader(std::istream& is, bool& bodyIndex)
+	{
+		char magic[sizeof(FILE_MAGIC)];
+		uint32_t version, jointCount, flags, reserved;
+		is.read(magic, sizeof(magic));
+		if (!readValue(is, version) || !readValue(is, jointCount) || !readValue(is, flags) || !readValue(is, reserved))
+		{
+			ofLogError(__FUNCTION__) << "Could not read header!";
+			return false;
+		}
+
+		if (std::memcmp(magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 || version != VERSION || jointCount != K4ABT_JOINT_COUNT)
+		{
+			ofLogError(__FUNCTION__) << "Unsupported file, version " << version << " with " << jointCount << " joints.";
+			return false;
+		}
+
+		bodyIndex = (flags & FLAG_BODY_INDEX) != 0;
+		return true;
+	}
+
+	bool BodySerializer::writeFrame(std::ostream& os, const BodyFrame& frame, bool bodyIndex)
+	{
+		std::vector<uint8_t> skeletonData;
+		BodySerializer::writeSkeletons(frame.bodySkeletons, skeletonData);
+
+		writeValue<int64_t>(os, frame.timestamp.count());
+		writeValue<uint32_t>(os, static_cast<uint32_t>(skeletonData.size()));
+		os.write(reinterpret_cast<const char*>(skeletonData.data()), skeletonData.size());
+
+		if (bodyIndex)
+		{
+			const uint32_t width = static_cast<uint32_t>(frame.bodyIndexPix.getWidth());
+			const uint32_t height = static_cast<uint32_t>(frame.bodyIndexPix.getHeight());
+			writeValue<uint32_t>(os, width);
+			writeValue<uint32_t>(os, height);
+			if (width > 0 && height > 0)
+			{
+				os.write(reinterpret_cast<const char*>(frame.bodyIndexPix.getData()), width * height);
+			}
+		}
+
+		return static_cast<bool>(os);
+	}
+
+	bool BodySerializer::readFrame(std::istream& is, bool bodyIndex, BodyFrame& frame)
+	{
+		int64_t timestamp;
+		uint32_t skeletonBytes;
+		if (!readValue(is, timestamp) || !readValue(is, skeletonBytes))
+		{
+			// End of file.
+			return false;
+		}
+		frame.timestamp = std::chrono::microseconds(timestamp);
+
+		std::vector<uint8_t> skeletonData(skeletonBytes);
+		is.read(reinterpret_cast<char*>(skeletonData.data()), skeletonBytes);
+		if (!is || !BodySerializer::readSkeletons(skeletonData.data(), skeletonData.size(), frame.bodySkeletons))
+		{
+			ofLogError(__FUNCTION__) << "Truncated frame at " << timestamp << " usec.";
+			return false;
+		}
+
+		if (bodyIndex)
+		{
+			uint32_t width, height;
+			if (!readValue(is, width) || !readValue(is, height))
+			{
+				ofLogError(__FUNCTION__) << "Truncated frame at " << timestamp << " usec.";
+				return false;
+			}
+
+			if (width > 0 && height > 0)
+			{
+				frame.bodyIndexPix.allocate(width, height, 1);
+				is.read(reinterpret_cast<char*>(frame.bodyIndexPix.getData()), width * height);
+				if (!is)
+				{
+					ofLogError(__FUNCTION__) << "Truncated frame at " << timestamp << " usec.";
+					return false;
+				}
+			}
+			else
+			{
+				frame.bodyIndexPix.clear();
+			}
+		}
+
+		return true;
+	}
+}
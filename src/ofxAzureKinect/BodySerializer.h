@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+#include "BodyTracker.h"
+
+namespace ofxAzureKinect
+{
+	// Binary encoding for body tracking results, shared by the batch tracker output files
+	// and the skeleton track in recordings. All values are little-endian.
+	//
+	// Skeleton block:
+	//   uint32 numBodies
+	//   numBodies x {
+	//     uint32 id
+	//     K4ABT_JOINT_COUNT x {
+	//       float position[3]      (mm, depth camera space)
+	//       float orientation[4]   (w, x, y, z)
+	//       uint32 confidenceLevel
+	//     }
+	//   }
+	//
+	// Frame file:
+	//   header {
+	//     char magic[8]            "K4ABTSKL"
+	//     uint32 version
+	//     uint32 jointCount
+	//     uint32 flags             (bit 0: frames include body index maps)
+	//     uint32 reserved
+	//   }
+	//   frames until the end of file {
+	//     int64 timestamp          (device timestamp, usec)
+	//     uint32 skeletonBytes
+	//     skeleton block
+	//     if body index maps {
+	//       uint32 width
+	//       uint32 height
+	//       uint8 bodyIndex[width * height]   (K4ABT_BODY_INDEX_MAP_BACKGROUND for no body)
+	//     }
+	//   }
+	class BodySerializer
+	{
+	public:
+		static const uint32_t VERSION;
+		static const uint32_t FLAG_BODY_INDEX;
+
+		static void writeSkeletons(const std::vector<BodySkeleton>& skeletons, std::vector<uint8_t>& data);
+		static bool readSkeletons(const uint8_t* data, size_t size, std::vector<BodySkeleton>& skeletons);
+
+		static bool writeHeader(std::ostream& os, bool bodyIndex);
+		static bool readHeader(std::istream& is, bool& bodyIndex);
+
+		static bool writeFrame(std::ostream& os, const BodyFrame& frame, bool bodyIndex);
+		static bool readFrame(std::istream& is, bool bodyIndex, BodyFrame& frame);
+	};
+}
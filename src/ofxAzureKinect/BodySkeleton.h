@@ -0,0 +1,25 @@
+#pragma once
+
+#include <k4abttypes.h>
+
+#include "ofVectorMath.h"
+
+#include "Types.h"
+
+namespace ofxAzureKinect
+{
+	struct BodyJoint
+	{
+		glm::vec3 position;
+		glm::quat orientation;
+		ConfidenceLevel confidenceLevel;
+
+		glm::vec2 projPos;
+	};
+
+	struct BodySkeleton
+	{
+		uint32_t id;
+		BodyJoint joints[K4ABT_JOINT_COUNT];
+	};
+}
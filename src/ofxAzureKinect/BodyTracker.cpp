@@ -1,15 +1,51 @@
 #include "BodyTracker.h"
 
+#include <algorithm>
+
+#include "ofUtils.h"
+
+const int32_t POP_TIMEOUT_IN_MS = 100;
+
+// Slack on the max tracking rate, so that frame timing jitter doesn't skip extra captures.
+const int64_t RATE_TOLERANCE_IN_US = 2000;
+
+// Skipped timestamps kept on top of what can pile up between two results, about a second of captures.
+const size_t SKIPPED_TIMESTAMPS_MARGIN = 30;
+
 namespace ofxAzureKinect
 {
 	BodyTrackerSettings::BodyTrackerSettings()
 		: sensorOrientation(K4ABT_SENSOR_ORIENTATION_DEFAULT)
 		, processingMode(K4ABT_TRACKER_PROCESSING_MODE_GPU)
 		, gpuDeviceID(0)
+		, fallbackToCpu(true)
+		, modelPath("")
 		, imageType(K4A_CALIBRATION_TYPE_DEPTH)
 		, updateBodyIndex(true)
 		, updateBodiesWorld(true)
 		, updateBodiesImage(false)
+		, maxQueuedCaptures(2)
+		, historySize(8)
+		, maxExtrapolation(std::chrono::milliseconds(50))
+		, filterJoints(false)
+		, trackEveryNthCapture(1)
+		, maxTrackingRate(0)
+	{}
+
+	BodyFrame::BodyFrame()
+		: timestamp(0)
+		, latency(0)
+	{}
+
+	BodyTrackerStats::BodyTrackerStats()
+		: numEnqueued(0)
+		, numDropped(0)
+		, numSkipped(0)
+		, numInterpolated(0)
+		, numProcessed(0)
+		, numQueued(0)
+		, lastLatency(0)
+		, averageLatency(0)
 	{}
 
 	BodyTracker::BodyTracker()
@@ -18,6 +54,17 @@ namespace ofxAzureKinect
 		, bUpdateBodyIndex(false)
 		, bUpdateBodiesWorld(false)
 		, bUpdateBodiesImage(false)
+		, bFilterJoints(false)
+		, trackerConfig(K4ABT_TRACKER_CONFIG_DEFAULT)
+		, maxQueuedCaptures(2)
+		, numQueued(0)
+		, trackEveryNthCapture(1)
+		, minTrackingInterval(0)
+		, numCaptures(0)
+		, lastEnqueuedTimestamp(0)
+		, prevResultTimestamp(0)
+		, maxSkippedTimestamps(SKIPPED_TIMESTAMPS_MARGIN)
+		, latestBodyIndexTimestamp(0)
 	{}
 
 	BodyTracker::~BodyTracker()
@@ -31,21 +78,36 @@ namespace ofxAzureKinect
 
 		// Generate tracker config.
 		this->trackerConfig = K4ABT_TRACKER_CONFIG_DEFAULT;
-		this->trackerConfig.processing_mode = K4ABT_TRACKER_PROCESSING_MODE_GPU_CUDA;
+		this->trackerConfig.processing_mode = settings.processingMode;
 		this->trackerConfig.sensor_orientation = settings.sensorOrientation;
 		this->trackerConfig.gpu_device_id = settings.gpuDeviceID;
 
-		try
+		this->modelPath = settings.modelPath.empty() ? "" : ofToDataPath(settings.modelPath, true);
+		if (!this->modelPath.empty())
 		{
-			// Create tracker.
-			this->bodyTracker = k4abt::tracker::create(calibration, this->trackerConfig);
+			this->trackerConfig.model_path = this->modelPath.c_str();
 		}
-		catch (const k4a::error& e)
+
+		if (!BodyTracker::createTracker(calibration, this->trackerConfig, settings.fallbackToCpu, this->bodyTracker))
 		{
-			ofLogError(__FUNCTION__) << e.what();
 			return false;
 		}
 
+		this->calibration = calibration;
+		if (settings.imageType == K4A_CALIBRATION_TYPE_COLOR)
+		{
+			try
+			{
+				this->transformation = k4a::transformation(this->calibration);
+			}
+			catch (const k4a::error& e)
+			{
+				ofLogError(__FUNCTION__) << e.what();
+				this->bodyTracker.destroy();
+				return false;
+			}
+		}
+
 		// Add joint smoothing parameter listener.
 		this->eventListeners.push(this->jointSmoothing.newListener([this](float&)
 		{
@@ -58,41 +120,222 @@ namespace ofxAzureKinect
 		this->bUpdateBodiesWorld = settings.updateBodiesWorld || settings.updateBodiesImage;
 		this->bUpdateBodiesImage = settings.updateBodiesImage;
 
+		if (this->bUpdateBodiesImage && !this->jointProjector.setup(this->calibration, K4A_CALIBRATION_TYPE_DEPTH, this->imageType))
+		{
+			this->bUpdateBodiesImage = false;
+		}
+
+		this->history.setup(settings.historySize, settings.maxExtrapolation);
+
+		this->bFilterJoints = settings.filterJoints;
+		this->jointFilter.clear();
+		this->jointFilter.setSettings(settings.jointFilter);
+
+		this->maxQueuedCaptures = std::max(settings.maxQueuedCaptures, size_t(1));
+		this->numQueued = 0;
+
+		this->trackEveryNthCapture = std::max(settings.trackEveryNthCapture, size_t(1));
+		this->minTrackingInterval = std::chrono::microseconds(settings.maxTrackingRate > 0 ? static_cast<int64_t>(1000000 / settings.maxTrackingRate) : 0);
+		this->numCaptures = 0;
+		this->lastEnqueuedTimestamp = std::chrono::microseconds(0);
+		this->prevResultTimestamp = std::chrono::microseconds(0);
+		this->maxSkippedTimestamps = this->maxQueuedCaptures * this->trackEveryNthCapture + SKIPPED_TIMESTAMPS_MARGIN;
+		this->interpolatedTimestamps.reserve(this->maxSkippedTimestamps);
+		{
+			std::unique_lock<std::mutex> lock(this->statsMutex);
+			this->enqueueTimes.clear();
+			this->skippedTimestamps.clear();
+			this->stats = BodyTrackerStats();
+		}
+
+		this->startThread();
+
 		this->bTracking = true;
 	
 		return true;
 	}
 
+	bool BodyTracker::createTracker(const k4a::calibration& calibration, k4abt_tracker_configuration_t& config, bool fallbackToCpu, k4abt::tracker& tracker)
+	{
+		try
+		{
+			tracker = k4abt::tracker::create(calibration, config);
+			return true;
+		}
+		catch (const k4a::error& e)
+		{
+			ofLogError(__FUNCTION__) << e.what();
+		}
+
+		if (!fallbackToCpu || config.processing_mode == K4ABT_TRACKER_PROCESSING_MODE_CPU)
+		{
+			return false;
+		}
+
+		// No usable GPU (or CUDA / TensorRT / DirectML runtime), try again on the CPU.
+		ofLogWarning(__FUNCTION__) << "Could not create tracker with processing mode " << config.processing_mode << ", falling back to CPU.";
+		config.processing_mode = K4ABT_TRACKER_PROCESSING_MODE_CPU;
+		try
+		{
+			tracker = k4abt::tracker::create(calibration, config);
+			return true;
+		}
+		catch (const k4a::error& e)
+		{
+			ofLogError(__FUNCTION__) << e.what();
+		}
+
+		return false;
+	}
+
 	bool BodyTracker::stopTracking()
 	{
 		if (!this->bTracking) return false;
 
 		this->eventListeners.unsubscribeAll();
 
-		this->bodyIndexPix.clear();
+		// Shutting down unblocks the pop on the tracker thread.
+		this->stopThread();
+		this->bodyTracker.shutdown();
+		this->waitForThread(false);
+
+		this->frameBuffer.reset();
+		this->history.clear();
 		this->bodyIndexTex.clear();
 
-		this->bodyTracker.shutdown();
+		{
+			// Give the last body index map back before the tracker goes away.
+			std::unique_lock<std::mutex> lock(this->bodyIndexMutex);
+			this->latestBodyIndexImg.reset();
+			this->latestBodyIds.clear();
+			this->latestBodyIndexTimestamp = std::chrono::microseconds(0);
+		}
+
 		this->bodyTracker.destroy();
+		this->depthInColorImg.reset();
+		this->transformation.destroy();
 
 		this->bTracking = false;
 
 		return true;
 	}
 
-	void BodyTracker::processCapture(const k4a::capture& capture, const k4a::calibration& calibration, const k4a::transformation& transformation, const k4a::image& depthImg)
+	bool BodyTracker::processCapture(const k4a::capture& capture)
+	{
+		const k4a::image depthImg = capture.get_depth_image();
+		const std::chrono::microseconds timestamp = depthImg ? depthImg.get_device_timestamp() : std::chrono::microseconds(0);
+
+		if (this->lastEnqueuedTimestamp.count() > 0 && timestamp <= this->lastEnqueuedTimestamp)
+		{
+			// Time went backwards, after a seek or a loop, the skipped captures won't get a result after them.
+			std::unique_lock<std::mutex> lock(this->statsMutex);
+			this->skippedTimestamps.clear();
+			this->lastEnqueuedTimestamp = std::chrono::microseconds(0);
+		}
+
+		// Only track some of the captures if asked to, the rest get interpolated once the next result is in.
+		const bool bSkipNth = (this->numCaptures++ % this->trackEveryNthCapture) != 0;
+		const bool bSkipRate = this->minTrackingInterval.count() > 0 && this->lastEnqueuedTimestamp.count() > 0 &&
+			(timestamp - this->lastEnqueuedTimestamp).count() + RATE_TOLERANCE_IN_US < this->minTrackingInterval.count();
+		if (bSkipNth || bSkipRate)
+		{
+			std::unique_lock<std::mutex> lock(this->statsMutex);
+			++this->stats.numSkipped;
+			this->addSkippedTimestamp(timestamp);
+			return false;
+		}
+
+		// Never wait on the tracker, drop the capture if it's busy.
+		if (this->numQueued >= this->maxQueuedCaptures)
+		{
+			std::unique_lock<std::mutex> lock(this->statsMutex);
+			++this->stats.numDropped;
+			this->addSkippedTimestamp(timestamp);
+			return false;
+		}
+
+		// Keep the stats lock so that the enqueue time is in before the result can be popped.
+		std::unique_lock<std::mutex> lock(this->statsMutex);
+		try
+		{
+			if (!this->bodyTracker.enqueue_capture(capture, std::chrono::milliseconds(0)))
+			{
+				++this->stats.numDropped;
+				this->addSkippedTimestamp(timestamp);
+				return false;
+			}
+		}
+		catch (const k4a::error& e)
+		{
+			ofLogError(__FUNCTION__) << e.what();
+			++this->stats.numDropped;
+			this->addSkippedTimestamp(timestamp);
+			return false;
+		}
+
+		this->enqueueTimes.push_back(std::chrono::steady_clock::now());
+		++this->stats.numEnqueued;
+		++this->numQueued;
+
+		this->lastEnqueuedTimestamp = timestamp;
+
+		return true;
+	}
+
+	void BodyTracker::threadedFunction()
+	{
+		while (this->isThreadRunning())
+		{
+			k4abt::frame bodyFrame;
+			try
+			{
+				bodyFrame = this->bodyTracker.pop_result(std::chrono::milliseconds(POP_TIMEOUT_IN_MS));
+			}
+			catch (const k4a::error& e)
+			{
+				// Expected once the tracker is shut down.
+				if (this->isThreadRunning())
+				{
+					ofLogError(__FUNCTION__) << e.what();
+				}
+				continue;
+			}
+
+			if (bodyFrame == nullptr) continue;
+
+			this->processResult(bodyFrame);
+		}
+	}
+
+	void BodyTracker::processResult(k4abt::frame& bodyFrame)
 	{
-		if (!this->bodyTracker.enqueue_capture(capture, std::chrono::milliseconds(0)))
+		// Results come out in the order the captures went in.
+		const auto now = std::chrono::steady_clock::now();
+		std::chrono::microseconds latency(0);
 		{
-			ofLogError(__FUNCTION__) << "Failed adding capture to tracker process queue!";
-			return;
+			std::unique_lock<std::mutex> lock(this->statsMutex);
+			if (!this->enqueueTimes.empty())
+			{
+				latency = std::chrono::duration_cast<std::chrono::microseconds>(now - this->enqueueTimes.front());
+				this->enqueueTimes.pop_front();
+			}
+
+			++this->stats.numProcessed;
+			this->stats.lastLatency = latency;
+			this->stats.averageLatency = (this->stats.numProcessed == 1) ? latency : (this->stats.averageLatency * 9 + latency) / 10;
 		}
-		
-		k4abt::frame bodyFrame = this->bodyTracker.pop_result(std::chrono::milliseconds(0));
-		if (bodyFrame == nullptr)
+		if (this->numQueued > 0) --this->numQueued;
+
+		BodyFrame& frame = this->frameBuffer.getBack();
+		frame.timestamp = bodyFrame.get_device_timestamp();
+		frame.latency = latency;
+
+		if (frame.timestamp <= this->prevResultTimestamp)
 		{
-			ofLogError(__FUNCTION__) << "Failed processing capture!";
-			return;
+			// Time went backwards, after a seek or a loop, nothing to interpolate from.
+			std::unique_lock<std::mutex> lock(this->statsMutex);
+			this->skippedTimestamps.clear();
+			this->prevResultTimestamp = std::chrono::microseconds(0);
 		}
 
 		if (this->bUpdateBodyIndex)
@@ -102,30 +345,46 @@ namespace ofxAzureKinect
 
 			if (this->imageType == K4A_CALIBRATION_TYPE_COLOR)
 			{
+				const int colorWidth = this->calibration.color_camera_calibration.resolution_width;
+				const int colorHeight = this->calibration.color_camera_calibration.resolution_height;
+
 				try
 				{
-					k4a::image transformedBodyIndexImg = transformation.depth_image_to_color_camera_custom(depthImg, bodyIndexImg,
-						K4A_TRANSFORMATION_INTERPOLATION_TYPE_NEAREST, K4ABT_BODY_INDEX_MAP_BACKGROUND).second;
+					// Both outputs are allocated once, the body index one over the frame's own pixels.
+					if (!frame.bodyIndexImg)
+					{
+						frame.bodyIndexPix.allocate(colorWidth, colorHeight, 1);
+						frame.bodyIndexImg = k4a::image::create_from_buffer(K4A_IMAGE_FORMAT_CUSTOM8, colorWidth, colorHeight, colorWidth,
+							frame.bodyIndexPix.getData(), frame.bodyIndexPix.size(), nullptr, nullptr);
+					}
+					if (!this->depthInColorImg)
+					{
+						this->depthInColorImg = k4a::image::create(K4A_IMAGE_FORMAT_DEPTH16, colorWidth, colorHeight, colorWidth * static_cast<int>(sizeof(uint16_t)));
+					}
 
-					// Swap body index image with transformed version.
-					bodyIndexImg.reset();
-					bodyIndexImg = std::move(transformedBodyIndexImg);
+					const k4a::image depthImg = bodyFrame.get_capture().get_depth_image();
+					this->transformation.depth_image_to_color_camera_custom(depthImg, bodyIndexImg, &this->depthInColorImg, &frame.bodyIndexImg,
+						K4A_TRANSFORMATION_INTERPOLATION_TYPE_NEAREST, K4ABT_BODY_INDEX_MAP_BACKGROUND);
 				}
 				catch (const k4a::error& e)
 				{
 					ofLogError(__FUNCTION__) << e.what();
 				}
-			}
 
-			const auto bodyIndexDims = glm::ivec2(bodyIndexImg.get_width_pixels(), bodyIndexImg.get_height_pixels());
-			if (!this->bodyIndexPix.isAllocated())
-			{
-				this->bodyIndexPix.allocate(bodyIndexDims.x, bodyIndexDims.y, 1);
+				ofLogVerbose(__FUNCTION__) << "Capture BodyIndex " << colorWidth << "x" << colorHeight << " in color space.";
 			}
+			else
+			{
+				const auto bodyIndexDims = glm::ivec2(bodyIndexImg.get_width_pixels(), bodyIndexImg.get_height_pixels());
+				if (!frame.bodyIndexPix.isAllocated())
+				{
+					frame.bodyIndexPix.allocate(bodyIndexDims.x, bodyIndexDims.y, 1);
+				}
 
-			const auto bodyIndexData = reinterpret_cast<uint8_t*>(bodyIndexImg.get_buffer());
-			this->bodyIndexPix.setFromPixels(bodyIndexData, bodyIndexDims.x, bodyIndexDims.y, 1);
-			ofLogVerbose(__FUNCTION__) << "Capture BodyIndex " << bodyIndexDims.x << "x" << bodyIndexDims.y << " stride: " << bodyIndexImg.get_stride_bytes() << ".";
+				const auto bodyIndexData = reinterpret_cast<uint8_t*>(bodyIndexImg.get_buffer());
+				frame.bodyIndexPix.setFromPixels(bodyIndexData, bodyIndexDims.x, bodyIndexDims.y, 1);
+				ofLogVerbose(__FUNCTION__) << "Capture BodyIndex " << bodyIndexDims.x << "x" << bodyIndexDims.y << " stride: " << bodyIndexImg.get_stride_bytes() << ".";
+			}
 
 			bodyIndexImg.reset();
 		}
@@ -135,53 +394,194 @@ namespace ofxAzureKinect
 
 		if (this->bUpdateBodiesWorld)
 		{
-			this->bodySkeletons.resize(numBodies);
+			frame.bodySkeletons.resize(numBodies);
 
 			for (size_t i = 0; i < numBodies; i++)
 			{
 				k4abt_skeleton_t skeleton = bodyFrame.get_body_skeleton(i);
 				uint32_t id = bodyFrame.get_body_id(i);
 
-				this->bodySkeletons[i].id = id;
+				frame.bodySkeletons[i].id = id;
 						
 				for (size_t j = 0; j < K4ABT_JOINT_COUNT; ++j)
 				{
-					this->bodySkeletons[i].joints[j].position = toGlm(skeleton.joints[j].position);
-					this->bodySkeletons[i].joints[j].orientation = toGlm(skeleton.joints[j].orientation);
-					this->bodySkeletons[i].joints[j].confidenceLevel = skeleton.joints[j].confidence_level;
+					frame.bodySkeletons[i].joints[j].position = toGlm(skeleton.joints[j].position);
+					frame.bodySkeletons[i].joints[j].orientation = toGlm(skeleton.joints[j].orientation);
+					frame.bodySkeletons[i].joints[j].confidenceLevel = skeleton.joints[j].confidence_level;
+				}
+			}
 
-					if (this->bUpdateBodiesImage)
+			if (this->bFilterJoints)
+			{
+				this->jointFilter.apply(frame.timestamp, frame.bodySkeletons);
+			}
+
+			if (this->bUpdateBodiesImage)
+			{
+				// Project every joint of every body in one go.
+				this->jointPositions.resize(numBodies * K4ABT_JOINT_COUNT);
+				for (size_t i = 0; i < numBodies; i++)
+				{
+					for (size_t j = 0; j < K4ABT_JOINT_COUNT; ++j)
 					{
-						try
-						{
-							k4a_float2_t projPos;
-							calibration.convert_3d_to_2d(skeleton.joints[j].position, K4A_CALIBRATION_TYPE_DEPTH, this->imageType, &projPos);
-							this->bodySkeletons[i].joints[j].projPos = toGlm(projPos);
-						}
-						catch (const k4a::error& e)
-						{
-							ofLogError(__FUNCTION__) << e.what();
-						}
+						this->jointPositions[i * K4ABT_JOINT_COUNT + j] = frame.bodySkeletons[i].joints[j].position;
+					}
+				}
+
+				this->jointProjector.project(this->jointPositions, this->jointProjPositions);
+				for (size_t i = 0; i < numBodies; i++)
+				{
+					for (size_t j = 0; j < K4ABT_JOINT_COUNT; ++j)
+					{
+						frame.bodySkeletons[i].joints[j].projPos = this->jointProjPositions[i * K4ABT_JOINT_COUNT + j];
 					}
 				}
 			}
+
+			this->history.add(frame.timestamp, frame.bodySkeletons);
+		}
+
+		this->interpolateSkipped(frame.timestamp);
+
+		{
+			// Keep the raw map around for splitting point clouds on the sensor thread.
+			std::unique_lock<std::mutex> lock(this->bodyIndexMutex);
+			this->latestBodyIndexImg = bodyFrame.get_body_index_map();
+			this->latestBodyIndexTimestamp = frame.timestamp;
+			this->latestBodyIds.resize(numBodies);
+			for (size_t i = 0; i < numBodies; ++i)
+			{
+				this->latestBodyIds[i] = bodyFrame.get_body_id(i);
+			}
 		}
 
 		// Release body frame once we're finished.
 		bodyFrame.reset();
+
+		{
+			std::unique_lock<std::mutex> lock(this->callbackMutex);
+			if (this->resultCallback)
+			{
+				this->resultCallback(frame);
+			}
+		}
+
+		this->prevResultTimestamp = frame.timestamp;
+
+		this->frameBuffer.publish();
+	}
+
+	bool BodyTracker::sampleBody(uint32_t id, std::chrono::microseconds timestamp, BodySkeleton& skeleton) const
+	{
+		return this->history.sample(id, timestamp, skeleton);
+	}
+
+	size_t BodyTracker::sampleBodies(std::chrono::microseconds timestamp, std::vector<BodySkeleton>& skeletons) const
+	{
+		return this->history.sampleAll(timestamp, skeletons);
+	}
+
+	std::chrono::microseconds BodyTracker::getEstimatedTimestamp() const
+	{
+		return this->history.getEstimatedTimestamp();
+	}
+
+	void BodyTracker::setJointFilterSettings(const JointFilterSettings& settings)
+	{
+		this->jointFilter.setSettings(settings);
+	}
+
+	JointFilterSettings BodyTracker::getJointFilterSettings() const
+	{
+		return this->jointFilter.getSettings();
+	}
+
+	const SkeletonHistory& BodyTracker::getHistory() const
+	{
+		return this->history;
+	}
+
+	bool BodyTracker::getLatestBodyIndex(k4a::image& bodyIndexImg, std::vector<uint32_t>& bodyIds, std::chrono::microseconds& timestamp) const
+	{
+		std::unique_lock<std::mutex> lock(this->bodyIndexMutex);
+		if (!this->latestBodyIndexImg) return false;
+
+		bodyIndexImg = this->latestBodyIndexImg;
+		bodyIds = this->latestBodyIds;
+		timestamp = this->latestBodyIndexTimestamp;
+		return true;
+	}
+
+	void BodyTracker::setResultCallback(std::function<void(const BodyFrame&)> callback)
+	{
+		std::unique_lock<std::mutex> lock(this->callbackMutex);
+		this->resultCallback = callback;
+	}
+
+	void BodyTracker::addSkippedTimestamp(std::chrono::microseconds timestamp)
+	{
+		// Only drained by results, so don't let it grow if they stop coming.
+		if (this->skippedTimestamps.size() >= this->maxSkippedTimestamps)
+		{
+			this->skippedTimestamps.pop_front();
+		}
+		this->skippedTimestamps.push_back(timestamp);
+	}
+
+	void BodyTracker::interpolateSkipped(std::chrono::microseconds timestamp)
+	{
+		// Captures that were skipped or dropped since the previous result sit between it and this one.
+		std::vector<std::chrono::microseconds>& timestamps = this->interpolatedTimestamps;
+		timestamps.clear();
+		{
+			std::unique_lock<std::mutex> lock(this->statsMutex);
+			while (!this->skippedTimestamps.empty() && this->skippedTimestamps.front() < timestamp)
+			{
+				timestamps.push_back(this->skippedTimestamps.front());
+				this->skippedTimestamps.pop_front();
+			}
+		}
+
+		if (timestamps.empty() || !this->bUpdateBodiesWorld || this->history.getHistorySize() < 2) return;
+		if (this->prevResultTimestamp.count() == 0) return;
+
+		std::unique_lock<std::mutex> lock(this->callbackMutex);
+		if (!this->resultCallback) return;
+
+		// Only results after the previous one are interpolated, older captures have nothing to go from.
+		for (const auto& skippedTimestamp : timestamps)
+		{
+			if (skippedTimestamp <= this->prevResultTimestamp) continue;
+
+			this->interpolatedFrame.timestamp = skippedTimestamp;
+			this->interpolatedFrame.latency = std::chrono::microseconds(0);
+			this->history.sampleAll(skippedTimestamp, this->interpolatedFrame.bodySkeletons);
+			this->resultCallback(this->interpolatedFrame);
+
+			std::unique_lock<std::mutex> statsLock(this->statsMutex);
+			++this->stats.numInterpolated;
+		}
+	}
+
+	bool BodyTracker::updateFrame()
+	{
+		return this->frameBuffer.swapFront();
 	}
 
 	void BodyTracker::updateTextures()
 	{
-		if (this->bUpdateBodyIndex && this->bodyIndexPix.isAllocated())
+		if (!this->updateFrame()) return;
+
+		const BodyFrame& frame = this->frameBuffer.getFront();
+		if (this->bUpdateBodyIndex && frame.bodyIndexPix.isAllocated())
 		{
 			if (!this->bodyIndexTex.isAllocated())
 			{
-				this->bodyIndexTex.allocate(this->bodyIndexPix);
+				this->bodyIndexTex.allocate(frame.bodyIndexPix);
 				this->bodyIndexTex.setTextureMinMagFilter(GL_NEAREST, GL_NEAREST);
 			}
 
-			this->bodyIndexTex.loadData(this->bodyIndexPix);
+			this->bodyIndexTex.loadData(frame.bodyIndexPix);
 		}
 	}
 
@@ -190,9 +590,14 @@ namespace ofxAzureKinect
 		return this->bTracking;
 	}
 
+	ProcessingMode BodyTracker::getProcessingMode() const
+	{
+		return this->trackerConfig.processing_mode;
+	}
+
 	const ofPixels& BodyTracker::getBodyIndexPix() const
 	{
-		return this->bodyIndexPix;
+		return this->frameBuffer.getFront().bodyIndexPix;
 	}
 
 	const ofTexture& BodyTracker::getBodyIndexTex() const
@@ -202,11 +607,24 @@ namespace ofxAzureKinect
 
 	size_t BodyTracker::getNumBodies() const
 	{
-		return this->bodySkeletons.size();
+		return this->frameBuffer.getFront().bodySkeletons.size();
 	}
 
 	const std::vector<BodySkeleton>& BodyTracker::getBodySkeletons() const
 	{
-		return this->bodySkeletons;
+		return this->frameBuffer.getFront().bodySkeletons;
+	}
+
+	std::chrono::microseconds BodyTracker::getTimestamp() const
+	{
+		return this->frameBuffer.getFront().timestamp;
+	}
+
+	BodyTrackerStats BodyTracker::getStats() const
+	{
+		std::unique_lock<std::mutex> lock(this->statsMutex);
+		BodyTrackerStats stats = this->stats;
+		stats.numQueued = this->numQueued;
+		return stats;
 	}
 }
\ No newline at end of file
@@ -1,12 +1,25 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+
 #include <k4a/k4a.hpp>
 #include <k4abt.hpp>
 
 #include "ofParameter.h"
 #include "ofPixels.h"
 #include "ofTexture.h"
+#include "ofThread.h"
 
+#include "BodySkeleton.h"
+#include "JointFilter.h"
+#include "PointProjector.h"
+#include "SkeletonHistory.h"
+#include "TripleBuffer.h"
 #include "Types.h"
 
 namespace ofxAzureKinect
@@ -16,31 +29,82 @@ namespace ofxAzureKinect
 		SensorOrientation sensorOrientation;
 		ProcessingMode processingMode;
 		int32_t gpuDeviceID;
+
+		// Retry on the CPU if the tracker can't be created with a GPU processing mode.
+		bool fallbackToCpu;
+
+		// Optional path to the ONNX model, relative to the data folder. Leave empty for the default model,
+		// or use the lite model (dnn_model_2_0_lite_op11.onnx) for much faster CPU inference.
+		std::string modelPath;
 		k4a_calibration_type_t imageType;
 		bool updateBodyIndex;
 		bool updateBodiesWorld;
 		bool updateBodiesImage;
 
+		// Max captures in the tracker at once, extra captures are dropped instead of blocking the sensor thread.
+		size_t maxQueuedCaptures;
+
+		// Results kept per body for sampleBody(), 0 turns the history off.
+		size_t historySize;
+		// How far past the latest result sampleBody() extrapolates.
+		std::chrono::microseconds maxExtrapolation;
+
+		// Smooth the joints with a One Euro filter, usually with the SDK smoothing (jointSmoothing) at 0.
+		bool filterJoints;
+		JointFilterSettings jointFilter;
+
+		// Only track every Nth capture, and at most this many captures per second (0 for no limit).
+		// getBodySkeletons() only ever holds tracked results. To get skeletons between them, sample the
+		// history every app frame with sampleBodies(getEstimatedTimestamp() - delay), with the delay at
+		// least the time between results (see example-bodies-world). Result callbacks also get an
+		// interpolated frame for each skipped capture once the next result is in.
+		size_t trackEveryNthCapture;
+		float maxTrackingRate;
+
 		BodyTrackerSettings();
 	};
 
-	struct BodyJoint
+	struct BodyFrame
 	{
-		glm::vec3 position;
-		glm::quat orientation;
-		ConfidenceLevel confidenceLevel;
+		// Device timestamp of the capture the results belong to.
+		std::chrono::microseconds timestamp;
+		// Time from enqueueing the capture to having its results.
+		std::chrono::microseconds latency;
+
+		ofPixels bodyIndexPix;
+		std::vector<BodySkeleton> bodySkeletons;
 
-		glm::vec2 projPos;
+		// Wraps bodyIndexPix when tracking in color space, so the remap writes straight into the pixels.
+		k4a::image bodyIndexImg;
+
+		BodyFrame();
 	};
 
-	struct BodySkeleton
+	struct BodyTrackerStats
 	{
-		uint32_t id;
-		BodyJoint joints[K4ABT_JOINT_COUNT];
+		uint64_t numEnqueued;
+		uint64_t numDropped;
+		uint64_t numSkipped;
+		uint64_t numInterpolated;
+		uint64_t numProcessed;
+		size_t numQueued;
+
+		std::chrono::microseconds lastLatency;
+		std::chrono::microseconds averageLatency;
+
+		BodyTrackerStats();
 	};
 
+	// Runs k4abt on its own thread: captures are enqueued without waiting and results
+	// are popped as they finish, then handed to the main thread through a triple buffer.
 	class BodyTracker
+		: public ofThread
 	{
+	public:
+		// Creates a tracker, retrying on the CPU if allowed and the requested mode fails.
+		// The config's processing mode is updated to the one that was used.
+		static bool createTracker(const k4a::calibration& calibration, k4abt_tracker_configuration_t& config, bool fallbackToCpu, k4abt::tracker& tracker);
+
 	public:
 		BodyTracker();
 		~BodyTracker();
@@ -48,36 +112,115 @@ namespace ofxAzureKinect
 		bool startTracking(const k4a::calibration& calibration, BodyTrackerSettings settings = BodyTrackerSettings());
 		bool stopTracking();
 
-		void processCapture(const k4a::capture& capture, const k4a::calibration& calibration, const k4a::transformation& transformation, const k4a::image& depthImg);
+		bool processCapture(const k4a::capture& capture);
+
+		// Called on the tracker thread with each result, before it is handed to the main thread.
+		void setResultCallback(std::function<void(const BodyFrame&)> callback);
+
+		bool updateFrame();
 		void updateTextures();
 
 		bool isTracking() const;
 
+		ProcessingMode getProcessingMode() const;
+
 		const ofPixels& getBodyIndexPix() const;
 		const ofTexture& getBodyIndexTex() const;
 
+		// Latest tracked result, captures skipped by trackEveryNthCapture or maxTrackingRate never show up here.
 		size_t getNumBodies() const;
 		const std::vector<BodySkeleton>& getBodySkeletons() const;
 
+		std::chrono::microseconds getTimestamp() const;
+		BodyTrackerStats getStats() const;
+
+		// Samples bodies from the history at any device timestamp, see SkeletonHistory.
+		bool sampleBody(uint32_t id, std::chrono::microseconds timestamp, BodySkeleton& skeleton) const;
+		size_t sampleBodies(std::chrono::microseconds timestamp, std::vector<BodySkeleton>& skeletons) const;
+
+		// Device time now, estimated from the latest result. Sample at this minus some delay to only interpolate.
+		std::chrono::microseconds getEstimatedTimestamp() const;
+
+		const SkeletonHistory& getHistory() const;
+
+		// Can be changed while tracking, when started with filterJoints.
+		void setJointFilterSettings(const JointFilterSettings& settings);
+		JointFilterSettings getJointFilterSettings() const;
+
+		// Latest body index map in depth space, the id of each body index in it and the device timestamp
+		// of the capture it was tracked from, safe from any thread.
+		bool getLatestBodyIndex(k4a::image& bodyIndexImg, std::vector<uint32_t>& bodyIds, std::chrono::microseconds& timestamp) const;
+
 	public:
 		ofParameter<float> jointSmoothing{ "Joint Smoothing", 0.0f, 0.0f, 1.0f };
 
+	protected:
+		void threadedFunction() override;
+
+		void processResult(k4abt::frame& bodyFrame);
+
+		// Call with the stats mutex held.
+		void addSkippedTimestamp(std::chrono::microseconds timestamp);
+		void interpolateSkipped(std::chrono::microseconds timestamp);
+
 	private:
 		bool bTracking;
 
 		bool bUpdateBodyIndex;
 		bool bUpdateBodiesWorld;
 		bool bUpdateBodiesImage;
+		bool bFilterJoints;
 
 		k4abt_tracker_configuration_t trackerConfig;
+		std::string modelPath;
 		k4abt::tracker bodyTracker;
 
+		// Our own copies, the transformation can't be shared with the sensor thread.
+		k4a::calibration calibration;
+		k4a::transformation transformation;
+
+		// Reused output for the depth image remapped alongside the body index map, which we don't need.
+		k4a::image depthInColorImg;
+
 		k4a_calibration_type_t imageType;
 
-		ofPixels bodyIndexPix;
-		ofTexture bodyIndexTex;
+		// Projects all joints of a frame in one batch for bodiesImage.
+		PointProjector jointProjector;
+		std::vector<glm::vec3> jointPositions;
+		std::vector<glm::vec2> jointProjPositions;
 
-		std::vector<BodySkeleton> bodySkeletons;
+		size_t maxQueuedCaptures;
+		std::atomic<size_t> numQueued;
+
+		size_t trackEveryNthCapture;
+		std::chrono::microseconds minTrackingInterval;
+		uint64_t numCaptures;
+		std::chrono::microseconds lastEnqueuedTimestamp;
+		std::chrono::microseconds prevResultTimestamp;
+		size_t maxSkippedTimestamps;
+		// Tracker thread only, reused for the skipped timestamps taken by each result.
+		std::vector<std::chrono::microseconds> interpolatedTimestamps;
+		BodyFrame interpolatedFrame;
+
+		mutable std::mutex statsMutex;
+		std::deque<std::chrono::steady_clock::time_point> enqueueTimes;
+		std::deque<std::chrono::microseconds> skippedTimestamps;
+		BodyTrackerStats stats;
+
+		TripleBuffer<BodyFrame> frameBuffer;
+
+		SkeletonHistory history;
+		JointFilter jointFilter;
+
+		std::function<void(const BodyFrame&)> resultCallback;
+		std::mutex callbackMutex;
+
+		mutable std::mutex bodyIndexMutex;
+		k4a::image latestBodyIndexImg;
+		std::vector<uint32_t> latestBodyIds;
+		std::chrono::microseconds latestBodyIndexTimestamp;
+
+		ofTexture bodyIndexTex;
 
 		ofEventListeners eventListeners;
 	};
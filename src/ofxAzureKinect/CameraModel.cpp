@@ -0,0 +1,244 @@
+#include "CameraModel.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "ofLog.h"
+
+const unsigned int MAX_UNPROJECT_PASSES = 20;
+
+namespace ofxAzureKinect
+{
+	const float CameraModel::TABLE_TOLERANCE = 1e-4f;
+
+	CameraModel::CameraModel()
+		: camera()
+		, bRational6kt(false)
+	{}
+
+	CameraModel::CameraModel(const k4a_calibration_camera_t& camera)
+	{
+		this->setup(camera);
+	}
+
+	void CameraModel::setup(const k4a_calibration_camera_t& camera)
+	{
+		this->camera = camera;
+		this->bRational6kt = (camera.intrinsics.type == K4A_CALIBRATION_LENS_DISTORTION_MODEL_RATIONAL_6KT);
+	}
+
+	bool CameraModel::isSupported() const
+	{
+		const auto& params = this->camera.intrinsics.parameters.param;
+		return (this->camera.intrinsics.type == K4A_CALIBRATION_LENS_DISTORTION_MODEL_RATIONAL_6KT ||
+			this->camera.intrinsics.type == K4A_CALIBRATION_LENS_DISTORTION_MODEL_BROWN_CONRADY) &&
+			params.fx > 0.f && params.fy > 0.f;
+	}
+
+	bool CameraModel::project(float x, float y, float& u, float& v, float* jacobian) const
+	{
+		const auto& params = this->camera.intrinsics.parameters.param;
+
+		const float xp = x - params.codx;
+		const float yp = y - params.cody;
+
+		const float xp2 = xp * xp;
+		const float yp2 = yp * yp;
+		const float xyp = xp * yp;
+		const float rs = xp2 + yp2;
+		if (rs > this->camera.metric_radius * this->camera.metric_radius)
+		{
+			return false;
+		}
+
+		const float rss = rs * rs;
+		const float rsc = rss * rs;
+		const float a = 1.f + params.k1 * rs + params.k2 * rss + params.k3 * rsc;
+		const float b = 1.f + params.k4 * rs + params.k5 * rss + params.k6 * rsc;
+		const float bi = (b != 0.f) ? 1.f / b : 1.f;
+		const float d = a * bi;
+
+		float xpd = xp * d;
+		float ypd = yp * d;
+
+		const float rs2xp2 = rs + 2.f * xp2;
+		const float rs2yp2 = rs + 2.f * yp2;
+
+		// Brown-Conrady doubles the cross tangential terms.
+		const float tangentialScale = this->bRational6kt ? 1.f : 2.f;
+		xpd += rs2xp2 * params.p2 + tangentialScale * xyp * params.p1;
+		ypd += rs2yp2 * params.p1 + tangentialScale * xyp * params.p2;
+
+		u = (xpd + params.codx) * params.fx + params.cx;
+		v = (ypd + params.cody) * params.fy + params.cy;
+
+		if (jacobian)
+		{
+			const float dudrs = params.k1 + 2.f * params.k2 * rs + 3.f * params.k3 * rss;
+			const float dvdrs = params.k4 + 2.f * params.k5 * rs + 3.f * params.k6 * rss;
+			const float bis = bi * bi;
+			const float dddrs = (dudrs * b - a * dvdrs) * bis;
+
+			const float dddrs2 = dddrs * 2.f;
+			const float xpdddrs2 = xp * dddrs2;
+			const float ypxpdddrs2 = yp * xpdddrs2;
+
+			jacobian[0] = params.fx * (d + xp * xpdddrs2 + 6.f * xp * params.p2 + tangentialScale * yp * params.p1);
+			jacobian[1] = params.fx * (ypxpdddrs2 + 2.f * yp * params.p2 + tangentialScale * xp * params.p1);
+			jacobian[2] = params.fy * (ypxpdddrs2 + 2.f * xp * params.p1 + tangentialScale * yp * params.p2);
+			jacobian[3] = params.fy * (d + yp * yp * dddrs2 + 6.f * yp * params.p1 + tangentialScale * xp * params.p2);
+		}
+
+		return true;
+	}
+
+	bool CameraModel::unproject(float u, float v, float& x, float& y) const
+	{
+		const auto& params = this->camera.intrinsics.parameters.param;
+
+		// Invert the radial distortion.
+		const float xpd = (u - params.cx) / params.fx - params.codx;
+		const float ypd = (v - params.cy) / params.fy - params.cody;
+
+		const float rs = xpd * xpd + ypd * ypd;
+		const float rss = rs * rs;
+		const float rsc = rss * rs;
+		const float a = 1.f + params.k1 * rs + params.k2 * rss + params.k3 * rsc;
+		const float b = 1.f + params.k4 * rs + params.k5 * rss + params.k6 * rsc;
+		const float ai = (a != 0.f) ? 1.f / a : 1.f;
+		const float di = ai * b;
+
+		x = xpd * di;
+		y = ypd * di;
+
+		// Approximate the tangential correction.
+		const float twoXy = 2.f * x * y;
+		const float xx = x * x;
+		const float yy = y * y;
+
+		x -= (yy + 3.f * xx) * params.p2 + twoXy * params.p1;
+		y -= (xx + 3.f * yy) * params.p1 + twoXy * params.p2;
+
+		x += params.codx;
+		y += params.cody;
+
+		// Then refine with Gauss-Newton.
+		return this->iterativeUnproject(u, v, x, y);
+	}
+
+	bool CameraModel::iterativeUnproject(float u, float v, float& x, float& y) const
+	{
+		float bestX = 0.f;
+		float bestY = 0.f;
+		float bestErr = FLT_MAX;
+
+		for (unsigned int pass = 0; pass < MAX_UNPROJECT_PASSES; ++pass)
+		{
+			float pu, pv;
+			float jacobian[4];
+			if (!this->project(x, y, pu, pv, jacobian))
+			{
+				return false;
+			}
+
+			const float errX = u - pu;
+			const float errY = v - pv;
+			const float err = errX * errX + errY * errY;
+			if (err >= bestErr)
+			{
+				x = bestX;
+				y = bestY;
+				break;
+			}
+
+			bestErr = err;
+			bestX = x;
+			bestY = y;
+
+			if (pass + 1 == MAX_UNPROJECT_PASSES || bestErr < 1e-22f)
+			{
+				break;
+			}
+
+			const float invDet = 1.f / (jacobian[0] * jacobian[3] - jacobian[1] * jacobian[2]);
+			const float invJacobian[4] = {
+				invDet * jacobian[3], -invDet * jacobian[1],
+				-invDet * jacobian[2], invDet * jacobian[0]
+			};
+
+			x += invJacobian[0] * errX + invJacobian[1] * errY;
+			y += invJacobian[2] * errX + invJacobian[3] * errY;
+		}
+
+		return bestErr <= 1e-6f;
+	}
+
+	void CameraModel::unprojectRows(int rowBegin, int rowEnd, k4a_float2_t* tableData) const
+	{
+		const int width = this->camera.resolution_width;
+		for (int y = rowBegin; y < rowEnd; ++y)
+		{
+			k4a_float2_t* rowData = tableData + y * width;
+			for (int x = 0; x < width; ++x)
+			{
+				if (!this->unproject(static_cast<float>(x), static_cast<float>(y), rowData[x].xy.x, rowData[x].xy.y))
+				{
+					rowData[x].xy.x = 0;
+					rowData[x].xy.y = 0;
+				}
+			}
+		}
+	}
+
+	bool CameraModel::matchesSdk(const k4a::calibration& calibration, k4a_calibration_type_t type, const k4a_float2_t* tableData, int step) const
+	{
+		const int width = this->camera.resolution_width;
+		const int height = this->camera.resolution_height;
+
+		// Pixels right on the edge of the valid area can flip either way.
+		int numSamples = 0;
+		int numMismatches = 0;
+		float maxError = 0.f;
+
+		k4a_float2_t p;
+		k4a_float3_t ray;
+		for (int y = 0; y < height; y += step)
+		{
+			p.xy.y = static_cast<float>(y);
+
+			for (int x = 0; x < width; x += step)
+			{
+				p.xy.x = static_cast<float>(x);
+
+				const k4a_float2_t& val = tableData[y * width + x];
+				const bool bValid = val.xy.x != 0 || val.xy.y != 0;
+				++numSamples;
+
+				bool bSdkValid;
+				try
+				{
+					bSdkValid = calibration.convert_2d_to_3d(p, 1.f, type, type, &ray);
+				}
+				catch (const k4a::error& e)
+				{
+					ofLogError(__FUNCTION__) << e.what();
+					return false;
+				}
+
+				if (bValid != bSdkValid)
+				{
+					++numMismatches;
+				}
+				else if (bValid)
+				{
+					maxError = std::max(maxError, std::max(std::abs(val.xy.x - ray.xyz.x), std::abs(val.xy.y - ray.xyz.y)));
+				}
+			}
+		}
+
+		ofLogVerbose(__FUNCTION__) << "Max error " << maxError << ", " << numMismatches << " / " << numSamples << " validity mismatches.";
+
+		return maxError <= TABLE_TOLERANCE && numMismatches * 200 <= numSamples;
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <k4a/k4a.hpp>
+
+namespace ofxAzureKinect
+{
+	// Evaluates a camera's Brown-Conrady / Rational 6KT lens model directly,
+	// following the same steps as the SDK so that tables can be generated in bulk
+	// without a convert_2d_to_3d call per pixel.
+	class CameraModel
+	{
+	public:
+		// Max distance between our rays and the SDK's, in normalized image plane units.
+		// At 10 m depth this is 1 mm.
+		static const float TABLE_TOLERANCE;
+
+	public:
+		CameraModel();
+		CameraModel(const k4a_calibration_camera_t& camera);
+
+		void setup(const k4a_calibration_camera_t& camera);
+
+		bool isSupported() const;
+
+		bool project(float x, float y, float& u, float& v, float* jacobian = nullptr) const;
+		bool unproject(float u, float v, float& x, float& y) const;
+
+		// Fills rows of an image-to-world table, invalid pixels are set to 0.
+		void unprojectRows(int rowBegin, int rowEnd, k4a_float2_t* tableData) const;
+
+		// Compares a sparse grid of the table against the SDK.
+		bool matchesSdk(const k4a::calibration& calibration, k4a_calibration_type_t type, const k4a_float2_t* tableData, int step = 8) const;
+
+	private:
+		bool iterativeUnproject(float u, float v, float& x, float& y) const;
+
+	private:
+		k4a_calibration_camera_t camera;
+		bool bRational6kt;
+	};
+}
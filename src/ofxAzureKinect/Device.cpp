@@ -20,6 +20,14 @@ namespace ofxAzureKinect
 		, updateVbo(true)
 		, forceVboToDepthSize(false)
 		, syncImages(true)
+		, jpegDecodeThreads(0)
+		, jpegDecodeDownscale(1)
+		, pointCloudThreads(1)
+		, cacheWorldTables(false)
+		, halfFloatWorldTables(false)
+		, bodyPointClouds(false)
+		, backgroundPointCloud(true)
+		, headless(false)
 	{}
 
 	int Device::getInstalledCount()
@@ -164,6 +172,15 @@ namespace ofxAzureKinect
 		this->bUpdateVbo = deviceSettings.updateWorld && deviceSettings.updateVbo;
 		this->bForceVboToDepthSize = deviceSettings.forceVboToDepthSize;
 
+		this->numDecodeThreads = deviceSettings.jpegDecodeThreads;
+		this->jpegDecodeDownscale = deviceSettings.jpegDecodeDownscale;
+		this->numPointCloudThreads = deviceSettings.pointCloudThreads;
+		this->bCacheWorldTables = deviceSettings.cacheWorldTables;
+		this->bHalfFloatWorldTables = deviceSettings.halfFloatWorldTables;
+		this->bBodyPointClouds = deviceSettings.bodyPointClouds;
+		this->bBackgroundPointCloud = deviceSettings.backgroundPointCloud;
+		this->bHeadless = deviceSettings.headless;
+
 		// Get calibration.
 		try
 		{
@@ -177,10 +194,8 @@ namespace ofxAzureKinect
 
 		if (this->bUpdateColor)
 		{
-			// Create transformation and images.
+			// Create transformation, the images are set up per frame.
 			this->transformation = k4a::transformation(this->calibration);
-
-			this->setupTransformationImages();
 		}
 
 		if (this->bUpdateWorld)
@@ -232,12 +247,9 @@ namespace ofxAzureKinect
 
 		this->stopStreaming();
 
-		this->depthToWorldImg.reset();
-		this->colorToWorldImg.reset();
+		this->resetWorldTables();
 
 		this->transformation.destroy();
-		this->depthInColorImg.reset();
-		this->colorInDepthImg.reset();
 
 		this->device.stop_cameras();
 
@@ -258,8 +270,18 @@ namespace ofxAzureKinect
 			filepath = "k4a_" + ofGetTimestampString("%Y%m%d_%H%M%S") + ".mkv";
 		}
 
-		if (this->recorder.open(this->device, this->config, filepath))
+		// Write the tracker results alongside the captures, so playback can skip tracking.
+		const bool recordSkeletons = this->bodyTracker.isTracking();
+		if (this->recorder.open(this->device, this->config, filepath, recordSkeletons))
 		{
+			if (recordSkeletons)
+			{
+				this->bodyTracker.setResultCallback([this](const BodyFrame& frame)
+				{
+					this->recorder.writeBodyFrame(frame);
+				});
+			}
+
 			this->bRecording = true;
 		}
 
@@ -270,6 +292,7 @@ namespace ofxAzureKinect
 	{
 		if (!this->isRecording()) return false;
 
+		this->bodyTracker.setResultCallback(nullptr);
 		this->recorder.close();
 		this->bRecording = false;
 
@@ -286,6 +309,19 @@ namespace ofxAzureKinect
 		return this->device.is_sync_out_connected();
 	}
 
+	std::vector<uint8_t> Device::getRawCalibration() const
+	{
+		try
+		{
+			return this->device.get_raw_calibration();
+		}
+		catch (const k4a::error& e)
+		{
+			ofLogError(__FUNCTION__) << e.what();
+			return std::vector<uint8_t>();
+		}
+	}
+
 	bool Device::updateCapture()
 	{
 		try
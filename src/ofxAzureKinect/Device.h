@@ -33,6 +33,34 @@ namespace ofxAzureKinect
 
 		bool syncImages;
 
+		// Number of threads decoding MJPEG color, 0 decodes on the capture thread.
+		// Each thread adds a frame of latency but lets decoding overlap with the rest of the processing.
+		size_t jpegDecodeThreads;
+
+		// Decode MJPEG color at 1/2, 1/4 or 1/8 size, color pixels and texture are sized to match.
+		// Point cloud texture coordinates stay in full color resolution pixels.
+		int jpegDecodeDownscale;
+
+		// Number of threads building the point cloud, including the capture thread.
+		size_t pointCloudThreads;
+
+		// Keep the world tables on disk and load them back on later starts with the same calibration.
+		bool cacheWorldTables;
+
+		// Store the world tables as half floats, at half the memory and with GL_RG16F textures.
+		bool halfFloatWorldTables;
+
+		// Split the point cloud by the body tracker's body index map, see Stream::getBodyPointRanges().
+		// Uses the latest tracking result, which trails the depth frame by the tracker latency, see Stream::getBodyPointRangesTimestamp().
+		// Needs a depth sized point cloud, color sized clouds are built whole.
+		bool bodyPointClouds;
+
+		// Keep the background points in the point cloud when splitting by body.
+		bool backgroundPointCloud;
+
+		// Skip all GL work and the update listener, frames are picked up with pollFrame() or a frame callback instead.
+		bool headless;
+
 		DeviceSettings();
 	};
 
@@ -53,6 +81,7 @@ namespace ofxAzureKinect
 		bool startCameras(DeviceSettings deviceSettings = DeviceSettings());
 		bool stopCameras();
 
+		// Skeletons are written to the recording too if the body tracker is running when it starts.
 		bool startRecording(std::string filepath = "");
 		bool stopRecording();
 
@@ -76,6 +105,8 @@ namespace ofxAzureKinect
 		Recorder& getRecorder();
 
 	protected:
+		std::vector<uint8_t> getRawCalibration() const override;
+
 		bool updateCapture() override;
 
 		void updatePixels() override;
@@ -0,0 +1,73 @@
+#include "Frame.h"
+
+namespace ofxAzureKinect
+{
+	BodyPointRange::BodyPointRange()
+		: bodyId(0)
+		, offset(0)
+		, count(0)
+	{}
+
+	Frame::Frame()
+		: timestamp(0)
+		, numPoints(0)
+		, bodyIndexTimestamp(0)
+	{}
+
+	void Frame::releaseSensorImages()
+	{
+		// Pixels wrapping the image buffers would be left dangling.
+		this->depthPix.clear();
+		this->irPix.clear();
+		if (this->colorImg && this->colorPix.getData() == this->colorImg.get_buffer())
+		{
+			this->colorPix.clear();
+		}
+
+		this->depthImg.reset();
+		this->colorImg.reset();
+		this->irImg.reset();
+	}
+
+	ImageView<uint16_t> Frame::getDepthView() const
+	{
+		return this->makeView(this->depthPix);
+	}
+
+	ImageView<uint8_t> Frame::getColorView() const
+	{
+		return this->makeView(this->colorPix);
+	}
+
+	ImageView<uint16_t> Frame::getIrView() const
+	{
+		return this->makeView(this->irPix);
+	}
+
+	ImageView<uint16_t> Frame::getDepthInColorView() const
+	{
+		return this->makeView(this->depthInColorPix);
+	}
+
+	ImageView<uint8_t> Frame::getColorInDepthView() const
+	{
+		return this->makeView(this->colorInDepthPix);
+	}
+
+
+	template<typename T>
+	ImageView<T> Frame::makeView(const ofPixels_<T>& pix) const
+	{
+		ImageView<T> view;
+		if (pix.isAllocated())
+		{
+			view.data = pix.getData();
+			view.width = static_cast<int>(pix.getWidth());
+			view.height = static_cast<int>(pix.getHeight());
+			view.strideBytes = static_cast<int>(pix.getBytesStride());
+			view.numChannels = static_cast<int>(pix.getNumChannels());
+			view.frame = this->shared_from_this();
+		}
+		return view;
+	}
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include <k4a/k4a.hpp>
+
+#include "ofPixels.h"
+#include "ofVectorMath.h"
+
+namespace ofxAzureKinect
+{
+	struct Frame;
+
+	// Range of a frame's point caches belonging to one body.
+	struct BodyPointRange
+	{
+		uint32_t bodyId;
+		size_t offset;
+		size_t count;
+
+		BodyPointRange();
+	};
+
+	// Non-owning view into the pixels of a Frame.
+	// The view holds a reference on its frame, so the underlying SDK buffers are
+	// only handed back once the frame and all of its views have been released.
+	template<typename T>
+	struct ImageView
+	{
+		const T* data;
+		int width;
+		int height;
+		int strideBytes;
+		int numChannels;
+
+		std::shared_ptr<const Frame> frame;
+
+		ImageView()
+			: data(nullptr)
+			, width(0)
+			, height(0)
+			, strideBytes(0)
+			, numChannels(0)
+		{}
+
+		explicit operator bool() const
+		{
+			return this->data != nullptr;
+		}
+
+		const T* getRow(int y) const
+		{
+			return reinterpret_cast<const T*>(reinterpret_cast<const uint8_t*>(this->data) + y * this->strideBytes);
+		}
+	};
+
+	struct Frame
+		: public std::enable_shared_from_this<Frame>
+	{
+		std::chrono::microseconds timestamp;
+
+		// SDK images backing the pixels below, reference counted by the SDK.
+		k4a::image depthImg;
+		k4a::image colorImg;
+		k4a::image irImg;
+		k4a::image depthInColorImg;
+		k4a::image colorInDepthImg;
+
+		// Pixels wrap the image buffers without copying, except for decoded MJPEG color.
+		ofShortPixels depthPix;
+		ofPixels colorPix;
+		ofShortPixels irPix;
+
+		ofShortPixels depthInColorPix;
+		ofPixels colorInDepthPix;
+
+		std::vector<glm::vec3> positionCache;
+		std::vector<glm::vec2> uvCache;
+		size_t numPoints;
+
+		// Only filled with body point clouds on, in which case the caches hold the points
+		// of each body one after the other, followed by the background.
+		std::vector<BodyPointRange> bodyPointRanges;
+		BodyPointRange backgroundPointRange;
+
+		// Device timestamp of the capture the body index map was tracked from, 0 if the points weren't split.
+		// Usually behind timestamp by the tracker latency, so moving bodies are cut with an older mask.
+		std::chrono::microseconds bodyIndexTimestamp;
+
+		Frame();
+
+		// Hands the sensor images back to the SDK early, keeping decoded color, transformed images and points.
+		void releaseSensorImages();
+
+		ImageView<uint16_t> getDepthView() const;
+		ImageView<uint8_t> getColorView() const;
+		ImageView<uint16_t> getIrView() const;
+		ImageView<uint16_t> getDepthInColorView() const;
+		ImageView<uint8_t> getColorInDepthView() const;
+
+	private:
+		template<typename T>
+		ImageView<T> makeView(const ofPixels_<T>& pix) const;
+	};
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace ofxAzureKinect
+{
+	// IEEE 754 binary16 conversions, for tables stored at half precision.
+
+	inline uint16_t floatToHalf(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+
+		const uint32_t sign = (bits >> 16) & 0x8000;
+		const uint32_t absBits = bits & 0x7FFFFFFF;
+
+		if (absBits >= 0x7F800000)
+		{
+			// Inf or NaN, keep NaNs quiet.
+			return static_cast<uint16_t>(sign | 0x7C00 | (absBits > 0x7F800000 ? 0x0200 : 0));
+		}
+		if (absBits >= 0x477FF000)
+		{
+			// Rounds past the largest half.
+			return static_cast<uint16_t>(sign | 0x7C00);
+		}
+		if (absBits < 0x38800000)
+		{
+			// Subnormal half or zero, round to nearest even.
+			if (absBits < 0x33000000) return static_cast<uint16_t>(sign);
+			const uint32_t mantissa = (absBits & 0x007FFFFF) | 0x00800000;
+			const uint32_t shift = 126 - (absBits >> 23);
+			const uint32_t halfMantissa = mantissa >> shift;
+			const uint32_t remainder = mantissa & ((1u << shift) - 1);
+			const uint32_t halfway = 1u << (shift - 1);
+			const uint32_t roundUp = (remainder > halfway || (remainder == halfway && (halfMantissa & 1))) ? 1 : 0;
+			return static_cast<uint16_t>(sign | (halfMantissa + roundUp));
+		}
+
+		// Normal, rebias the exponent and round to nearest even.
+		const uint32_t rebased = absBits - 0x38000000;
+		const uint32_t roundUp = ((rebased & 0x1FFF) > 0x1000 || ((rebased & 0x1FFF) == 0x1000 && (rebased & 0x2000))) ? 1 : 0;
+		return static_cast<uint16_t>(sign | ((rebased >> 13) + roundUp));
+	}
+
+	inline float halfToFloat(uint16_t half)
+	{
+		const uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+		uint32_t exponent = (half >> 10) & 0x1F;
+		uint32_t mantissa = half & 0x03FF;
+
+		uint32_t bits;
+		if (exponent == 0x1F)
+		{
+			bits = sign | 0x7F800000 | (mantissa << 13);
+		}
+		else if (exponent != 0)
+		{
+			bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+		}
+		else if (mantissa != 0)
+		{
+			// Subnormal half, normalize it.
+			exponent = 113;
+			while ((mantissa & 0x0400) == 0)
+			{
+				mantissa <<= 1;
+				--exponent;
+			}
+			bits = sign | (exponent << 23) | ((mantissa & 0x03FF) << 13);
+		}
+		else
+		{
+			bits = sign;
+		}
+
+		float value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+}
@@ -0,0 +1,119 @@
+#include "JointFilter.h"
+
+#include <algorithm>
+
+namespace
+{
+	const float TWO_PI = 6.28318530718f;
+
+	// Exponential smoothing factor for a cutoff frequency and a time step.
+	inline float smoothingFactor(float cutoff, float dt)
+	{
+		const float r = TWO_PI * cutoff * dt;
+		return r / (r + 1.f);
+	}
+}
+
+namespace ofxAzureKinect
+{
+	JointFilterSettings::JointFilterSettings()
+		: positionMinCutoff(1.f)
+		, positionBeta(0.005f)
+		, orientationMinCutoff(1.f)
+		, orientationBeta(0.3f)
+		, derivativeCutoff(1.f)
+	{}
+
+	JointFilter::JointFilter()
+		: lastTimestamp(0)
+	{}
+
+	void JointFilter::setSettings(const JointFilterSettings& settings)
+	{
+		std::unique_lock<std::mutex> lock(this->settingsMutex);
+		this->settings = settings;
+	}
+
+	JointFilterSettings JointFilter::getSettings() const
+	{
+		std::unique_lock<std::mutex> lock(this->settingsMutex);
+		return this->settings;
+	}
+
+	void JointFilter::clear()
+	{
+		this->lastTimestamp = std::chrono::microseconds(0);
+		this->ids.clear();
+		this->states.clear();
+		this->prevIds.clear();
+		this->prevStates.clear();
+	}
+
+	void JointFilter::apply(std::chrono::microseconds timestamp, std::vector<BodySkeleton>& skeletons)
+	{
+		const JointFilterSettings settings = this->getSettings();
+
+		// Start over if time went backwards, after a seek or a loop.
+		const bool bReset = this->lastTimestamp.count() <= 0 || timestamp <= this->lastTimestamp;
+		const float dt = (timestamp - this->lastTimestamp).count() / 1000000.f;
+		this->lastTimestamp = timestamp;
+
+		const float derivativeAlpha = bReset ? 0.f : smoothingFactor(settings.derivativeCutoff, dt);
+
+		// The previous frame's state becomes the input, in the same order as its ids.
+		std::swap(this->ids, this->prevIds);
+		std::swap(this->states, this->prevStates);
+		this->ids.resize(skeletons.size());
+		this->states.resize(skeletons.size() * K4ABT_JOINT_COUNT);
+
+		for (size_t i = 0; i < skeletons.size(); ++i)
+		{
+			BodySkeleton& skeleton = skeletons[i];
+			this->ids[i] = skeleton.id;
+			JointState* state = &this->states[i * K4ABT_JOINT_COUNT];
+
+			const auto it = std::find(this->prevIds.begin(), this->prevIds.end(), skeleton.id);
+			if (bReset || it == this->prevIds.end())
+			{
+				// New body, nothing to filter against yet.
+				for (size_t j = 0; j < K4ABT_JOINT_COUNT; ++j)
+				{
+					const BodyJoint& joint = skeleton.joints[j];
+					state[j].position = joint.position;
+					state[j].velocity = glm::vec3(0.f);
+					state[j].orientation = glm::vec4(joint.orientation.x, joint.orientation.y, joint.orientation.z, joint.orientation.w);
+					state[j].angularVelocity = glm::vec4(0.f);
+				}
+				continue;
+			}
+
+			const JointState* prevState = &this->prevStates[(it - this->prevIds.begin()) * K4ABT_JOINT_COUNT];
+			for (size_t j = 0; j < K4ABT_JOINT_COUNT; ++j)
+			{
+				BodyJoint& joint = skeleton.joints[j];
+				const JointState& prev = prevState[j];
+				JointState& curr = state[j];
+
+				// Position, with the cutoff rising with speed.
+				const glm::vec3 velocity = (joint.position - prev.position) / dt;
+				curr.velocity = glm::mix(prev.velocity, velocity, derivativeAlpha);
+				const float positionAlpha = smoothingFactor(settings.positionMinCutoff + settings.positionBeta * glm::length(curr.velocity), dt);
+				curr.position = glm::mix(prev.position, joint.position, positionAlpha);
+
+				// Orientation, flipped to the same hemisphere as the previous one so they blend the short way.
+				glm::vec4 orientation(joint.orientation.x, joint.orientation.y, joint.orientation.z, joint.orientation.w);
+				if (glm::dot(orientation, prev.orientation) < 0.f)
+				{
+					orientation = -orientation;
+				}
+				const glm::vec4 angularVelocity = (orientation - prev.orientation) / dt;
+				curr.angularVelocity = glm::mix(prev.angularVelocity, angularVelocity, derivativeAlpha);
+				const float orientationAlpha = smoothingFactor(settings.orientationMinCutoff + settings.orientationBeta * glm::length(curr.angularVelocity), dt);
+				curr.orientation = glm::normalize(glm::mix(prev.orientation, orientation, orientationAlpha));
+
+				joint.position = curr.position;
+				joint.orientation = glm::quat(curr.orientation.w, curr.orientation.x, curr.orientation.y, curr.orientation.z);
+			}
+		}
+	}
+}
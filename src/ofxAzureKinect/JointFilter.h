@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include "BodySkeleton.h"
+
+namespace ofxAzureKinect
+{
+	struct JointFilterSettings
+	{
+		// Cutoff in Hz when a joint is still, lower is smoother but lags more.
+		float positionMinCutoff;
+		// How fast the cutoff rises with speed (per mm/s), higher cuts lag on fast moves.
+		float positionBeta;
+
+		float orientationMinCutoff;
+		float orientationBeta;
+
+		// Cutoff in Hz for the speed estimate itself.
+		float derivativeCutoff;
+
+		JointFilterSettings();
+	};
+
+	// One Euro filter on every joint of every body, keyed by body id.
+	// The state of all joints of all bodies lives in one flat array, so a frame
+	// is filtered in a single pass over contiguous memory.
+	// Orientations are filtered as 4D vectors on the same hemisphere then normalized.
+	class JointFilter
+	{
+	public:
+		JointFilter();
+
+		// Safe to call from any thread, applies from the next frame.
+		void setSettings(const JointFilterSettings& settings);
+		JointFilterSettings getSettings() const;
+
+		void clear();
+
+		// Filters the skeletons in place. Bodies that are not in the frame lose their state.
+		void apply(std::chrono::microseconds timestamp, std::vector<BodySkeleton>& skeletons);
+
+	private:
+		struct JointState
+		{
+			glm::vec3 position;
+			glm::vec3 velocity;
+			glm::vec4 orientation;
+			glm::vec4 angularVelocity;
+		};
+
+	private:
+		JointFilterSettings settings;
+		mutable std::mutex settingsMutex;
+
+		std::chrono::microseconds lastTimestamp;
+
+		// One id and K4ABT_JOINT_COUNT states per body, in the same order.
+		std::vector<uint32_t> ids;
+		std::vector<JointState> states;
+
+		std::vector<uint32_t> prevIds;
+		std::vector<JointState> prevStates;
+	};
+}
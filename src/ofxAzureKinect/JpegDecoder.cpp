@@ -0,0 +1,218 @@
+#include "JpegDecoder.h"
+
+#include "ofLog.h"
+#include "ofVectorMath.h"
+
+namespace ofxAzureKinect
+{
+	bool JpegDecoder::isValidDownscale(int downscale)
+	{
+		// These are always supported by turbojpeg's DCT scaling.
+		return downscale == 1 || downscale == 2 || downscale == 4 || downscale == 8;
+	}
+
+	bool JpegDecoder::decode(tjhandle handle, const k4a::image& jpegImg, ofPixels& pix, int downscale)
+	{
+		// Scale in the DCT domain, which skips most of the decoding work for the dropped resolution.
+		const tjscalingfactor scalingFactor = { 1, downscale };
+		const auto dims = glm::ivec2(
+			TJSCALED(jpegImg.get_width_pixels(), scalingFactor),
+			TJSCALED(jpegImg.get_height_pixels(), scalingFactor));
+		if (!pix.isAllocated() || static_cast<int>(pix.getWidth()) != dims.x || static_cast<int>(pix.getHeight()) != dims.y)
+		{
+			pix.allocate(dims.x, dims.y, OF_PIXELS_BGRA);
+		}
+
+		const int decompressStatus = tjDecompress2(handle,
+			jpegImg.get_buffer(),
+			static_cast<unsigned long>(jpegImg.get_size()),
+			pix.getData(),
+			dims.x,
+			0, // pitch
+			dims.y,
+			TJPF_BGRA,
+			TJFLAG_FASTDCT | TJFLAG_FASTUPSAMPLE);
+		if (decompressStatus != 0)
+		{
+			ofLogError(__FUNCTION__) << "Failed decoding MJPEG image: " << tjGetErrorStr2(handle);
+			return false;
+		}
+
+		return true;
+	}
+
+	JpegDecoder::JpegDecoder()
+		: bRunning(false)
+		, downscale(1)
+		, nextTicket(1)
+	{}
+
+	JpegDecoder::~JpegDecoder()
+	{
+		this->close();
+	}
+
+	bool JpegDecoder::setup(size_t numThreads, int downscale)
+	{
+		if (this->bRunning) return false;
+
+		if (numThreads == 0)
+		{
+			ofLogError(__FUNCTION__) << "Decoder needs at least one thread!";
+			return false;
+		}
+
+		if (!JpegDecoder::isValidDownscale(downscale))
+		{
+			ofLogError(__FUNCTION__) << "Unsupported downscale " << downscale << ", must be 1, 2, 4 or 8!";
+			return false;
+		}
+
+		this->downscale = downscale;
+
+		this->bRunning = true;
+		for (size_t i = 0; i < numThreads; ++i)
+		{
+			this->workers.emplace_back(&JpegDecoder::workerFunction, this);
+		}
+
+		return true;
+	}
+
+	bool JpegDecoder::close()
+	{
+		if (!this->bRunning) return false;
+
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+			this->bRunning = false;
+		}
+		this->jobCondition.notify_all();
+
+		for (auto& worker : this->workers)
+		{
+			worker.join();
+		}
+		this->workers.clear();
+
+		this->jobs.clear();
+		this->freePixels.clear();
+
+		return true;
+	}
+
+	bool JpegDecoder::isRunning() const
+	{
+		return this->bRunning;
+	}
+
+	size_t JpegDecoder::getNumThreads() const
+	{
+		return this->workers.size();
+	}
+
+	uint64_t JpegDecoder::submit(const k4a::image& jpegImg)
+	{
+		std::unique_lock<std::mutex> lock(this->mutex);
+
+		this->jobs.emplace_back();
+		Job& job = this->jobs.back();
+		job.ticket = this->nextTicket++;
+		job.jpegImg = jpegImg;
+		job.bStarted = false;
+		job.bDone = !jpegImg;
+		job.bSuccess = false;
+
+		if (!this->freePixels.empty())
+		{
+			// Recycle a buffer from a previous job.
+			job.pix.swap(this->freePixels.back());
+			this->freePixels.pop_back();
+		}
+
+		const uint64_t ticket = job.ticket;
+
+		lock.unlock();
+		this->jobCondition.notify_one();
+
+		return ticket;
+	}
+
+	bool JpegDecoder::wait(uint64_t ticket, ofPixels& pix)
+	{
+		std::unique_lock<std::mutex> lock(this->mutex);
+
+		auto it = this->jobs.begin();
+		while (it != this->jobs.end() && it->ticket != ticket)
+		{
+			++it;
+		}
+
+		if (it == this->jobs.end())
+		{
+			ofLogError(__FUNCTION__) << "No job found for ticket " << ticket << "!";
+			return false;
+		}
+
+		while (!it->bDone)
+		{
+			this->doneCondition.wait(lock);
+		}
+
+		// Hand the decoded pixels over and keep the caller's old buffer for a later job.
+		const bool success = it->bSuccess;
+		if (success)
+		{
+			pix.swap(it->pix);
+		}
+		if (it->pix.isAllocated())
+		{
+			this->freePixels.emplace_back();
+			this->freePixels.back().swap(it->pix);
+		}
+		this->jobs.erase(it);
+
+		return success;
+	}
+
+	void JpegDecoder::workerFunction()
+	{
+		tjhandle jpegDecompressor = tjInitDecompress();
+
+		std::unique_lock<std::mutex> lock(this->mutex);
+		while (this->bRunning)
+		{
+			// Take the oldest job that nobody is working on yet.
+			Job* job = nullptr;
+			for (auto& candidate : this->jobs)
+			{
+				if (!candidate.bStarted && !candidate.bDone)
+				{
+					job = &candidate;
+					break;
+				}
+			}
+
+			if (job == nullptr)
+			{
+				this->jobCondition.wait(lock);
+				continue;
+			}
+
+			job->bStarted = true;
+			lock.unlock();
+
+			// The job stays put in the list until its ticket is waited on, which only happens once it's done.
+			const bool success = JpegDecoder::decode(jpegDecompressor, job->jpegImg, job->pix, this->downscale);
+			job->jpegImg.reset();
+
+			lock.lock();
+			job->bSuccess = success;
+			job->bDone = true;
+			this->doneCondition.notify_all();
+		}
+		lock.unlock();
+
+		tjDestroy(jpegDecompressor);
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <k4a/k4a.hpp>
+#include <turbojpeg.h>
+
+#include "ofPixels.h"
+
+namespace ofxAzureKinect
+{
+	// Decodes MJPEG color images on a pool of worker threads, each with its own turbojpeg handle.
+	// Jobs are decoded concurrently but handed back in the order they were submitted.
+	class JpegDecoder
+	{
+	public:
+		static bool isValidDownscale(int downscale);
+		static bool decode(tjhandle handle, const k4a::image& jpegImg, ofPixels& pix, int downscale = 1);
+
+	public:
+		JpegDecoder();
+		~JpegDecoder();
+
+		bool setup(size_t numThreads, int downscale = 1);
+		bool close();
+
+		bool isRunning() const;
+		size_t getNumThreads() const;
+
+		uint64_t submit(const k4a::image& jpegImg);
+		bool wait(uint64_t ticket, ofPixels& pix);
+
+	private:
+		struct Job
+		{
+			uint64_t ticket;
+			k4a::image jpegImg;
+			ofPixels pix;
+			bool bStarted;
+			bool bDone;
+			bool bSuccess;
+		};
+
+		void workerFunction();
+
+	private:
+		bool bRunning;
+		int downscale;
+
+		std::vector<std::thread> workers;
+
+		std::mutex mutex;
+		std::condition_variable jobCondition;
+		std::condition_variable doneCondition;
+
+		std::list<Job> jobs;
+		std::vector<ofPixels> freePixels;
+		uint64_t nextTicket;
+	};
+}
@@ -1,5 +1,10 @@
 #include "Playback.h"
 
+#include <algorithm>
+#include <thread>
+
+#include "Recorder.h"
+
 namespace ofxAzureKinect
 {
 	PlaybackSettings::PlaybackSettings()
@@ -9,6 +14,21 @@ namespace ofxAzureKinect
 		, updateVbo(true)
 		, forceVboToDepthSize(false)
 		, autoloop(true)
+		, jpegDecodeThreads(0)
+		, jpegDecodeDownscale(1)
+		, pointCloudThreads(1)
+		, cacheWorldTables(false)
+		, halfFloatWorldTables(false)
+		, bodyPointClouds(false)
+		, backgroundPointCloud(true)
+		, headless(false)
+		, readSkeletons(true)
+		, readAheadCaptures(4)
+		, readAheadMegabytes(0)
+		, rate(1.f)
+		, freeRun(false)
+		, cacheMode(PLAYBACK_CACHE_NONE)
+		, cacheMaxMegabytes(2048)
 	{}
 
 	Playback::Playback()
@@ -16,8 +36,13 @@ namespace ofxAzureKinect
 		, bUpdateDepth(true)
 		, bLoops(true)
 		, bPaused(false)
-		, lastFrameSecs(0)
+		, bHasSkeletonTrack(false)
+		, bReadSkeletons(false)
 		, duration(0)
+		, bFreeRun(false)
+		, bHoldingCapture(false)
+		, bGrouped(false)
+		, bGroupCaptureReady(false)
 	{
 
 	}
@@ -27,7 +52,7 @@ namespace ofxAzureKinect
 		this->close();
 	}
 
-	bool Playback::open(std::string filepath)
+	bool Playback::open(std::string filepath, bool buildIndex, bool cacheIndex)
 	{
 		if (this->bOpen) return false;
 
@@ -54,6 +79,9 @@ namespace ofxAzureKinect
 
 			// Get the duration.
 			this->duration = this->playback.get_recording_length();
+
+			// Check for skeletons written by the recorder.
+			this->bHasSkeletonTrack = k4a_playback_check_track_exists(this->playback.handle(), Recorder::SKELETON_TRACK_NAME);
 		}
 		catch (const k4a::error& e)
 		{
@@ -64,6 +92,33 @@ namespace ofxAzureKinect
 			return false;
 		}
 
+		if (buildIndex)
+		{
+			const std::string indexPath = PlaybackIndex::getFilePath(filepath);
+			const uint64_t indexKey = PlaybackIndex::makeKey(filepath, this->duration);
+			if (cacheIndex && this->index.load(indexPath, indexKey))
+			{
+				ofLogVerbose(__FUNCTION__) << "Loaded index from " << indexPath;
+			}
+			else if (this->index.build(this->playback))
+			{
+				ofLogVerbose(__FUNCTION__) << "Indexed " << this->index.getFrameCount() << " captures";
+
+				if (cacheIndex && this->index.save(indexPath, indexKey))
+				{
+					ofLogVerbose(__FUNCTION__) << "Saved index to " << indexPath;
+				}
+			}
+		}
+
+		if (!this->reader.open(filepath))
+		{
+			this->index.clear();
+			this->playback.close();
+
+			return false;
+		}
+
 		ofLogNotice(__FUNCTION__) << "Open success, reading from file " << filepath;
 
 		this->bOpen = true;
@@ -76,10 +131,13 @@ namespace ofxAzureKinect
 
 		this->stopPlayback();
 
+		this->reader.close();
 		this->playback.close();
+		this->index.clear();
 
 		ofLogNotice(__FUNCTION__) << "Close success";
 
+		this->bHasSkeletonTrack = false;
 		this->serialNumber = "";
 		this->bOpen = false;
 
@@ -101,17 +159,36 @@ namespace ofxAzureKinect
 		this->bUpdateWorld = this->config.depth_track_enabled && playbackSettings.updateWorld;
 		this->bUpdateVbo = this->config.depth_track_enabled && playbackSettings.updateWorld && playbackSettings.updateVbo;
 		this->bForceVboToDepthSize = playbackSettings.forceVboToDepthSize;
+
+		this->numDecodeThreads = playbackSettings.jpegDecodeThreads;
+		this->jpegDecodeDownscale = playbackSettings.jpegDecodeDownscale;
+		this->numPointCloudThreads = playbackSettings.pointCloudThreads;
+		this->bCacheWorldTables = playbackSettings.cacheWorldTables;
+		this->bHalfFloatWorldTables = playbackSettings.halfFloatWorldTables;
+		this->bBodyPointClouds = playbackSettings.bodyPointClouds;
+		this->bBackgroundPointCloud = playbackSettings.backgroundPointCloud;
+		this->bHeadless = playbackSettings.headless;
 	
 		this->bLoops = playbackSettings.autoloop;
+		this->bReadSkeletons = this->bHasSkeletonTrack && playbackSettings.readSkeletons;
 
-		this->lastFrameSecs = 0;
+		this->clock.setRate(playbackSettings.rate);
+		this->clock.clear();
+		this->bFreeRun = playbackSettings.freeRun;
+		this->bHoldingCapture = false;
+
+		this->readCapture.clear();
+		{
+			std::unique_lock<std::mutex> lock(this->groupMutex);
+			this->groupCapture.clear();
+			this->bGroupCaptureReady = false;
+		}
+		this->skeletonBuffer.reset();
 
 		if (this->bUpdateDepth && this->bUpdateColor)
 		{
-			// Create transformation and images.
+			// Create transformation, the images are set up per frame.
 			this->transformation = k4a::transformation(this->calibration);
-
-			this->setupTransformationImages();
 		}
 
 		if (this->bUpdateWorld)
@@ -126,7 +203,22 @@ namespace ofxAzureKinect
 			}
 		}
 
-		return this->startStreaming();
+		// MJPEG color is decoded by the reader, the stream only takes the pixels.
+		this->numDecodeThreads = 0;
+
+		if (!this->startStreaming()) return false;
+
+		PlaybackReaderSettings readerSettings;
+		readerSettings.maxCaptures = playbackSettings.readAheadCaptures;
+		readerSettings.maxMegabytes = playbackSettings.readAheadMegabytes;
+		readerSettings.decodeColor = this->bUpdateColor;
+		readerSettings.jpegDecodeThreads = playbackSettings.jpegDecodeThreads;
+		readerSettings.jpegDecodeDownscale = this->jpegDecodeDownscale;
+		readerSettings.readSkeletons = this->bReadSkeletons;
+		readerSettings.autoloop = this->bLoops;
+		readerSettings.cacheMode = playbackSettings.cacheMode;
+		readerSettings.cacheMaxMegabytes = playbackSettings.cacheMaxMegabytes;
+		return this->reader.start(readerSettings);
 	}
 
 	bool Playback::stopPlayback()
@@ -135,6 +227,8 @@ namespace ofxAzureKinect
 
 		this->stopStreaming();
 
+		this->reader.stop();
+
 		this->transformation.destroy();
 
 		return true;
@@ -142,6 +236,11 @@ namespace ofxAzureKinect
 
 	void Playback::setPaused(bool paused)
 	{
+		if (this->bPaused && !paused)
+		{
+			// Carry on from where we stopped instead of catching up.
+			this->clock.reset();
+		}
 		this->bPaused = paused;
 	}
 
@@ -150,6 +249,27 @@ namespace ofxAzureKinect
 		return this->bPaused;
 	}
 
+	void Playback::setRate(float rate)
+	{
+		this->clock.setRate(rate);
+	}
+
+	float Playback::getRate() const
+	{
+		return this->clock.getRate();
+	}
+
+	void Playback::setFreeRun(bool freeRun)
+	{
+		this->bFreeRun = freeRun;
+		this->clock.reset();
+	}
+
+	bool Playback::isFreeRun() const
+	{
+		return this->bFreeRun;
+	}
+
 	bool Playback::seekPct(float pct)
 	{
 		return this->seekUsecs(ofMap(pct, 0, 1, 0, this->getDurationUsecs(), true));
@@ -164,54 +284,219 @@ namespace ofxAzureKinect
 	{
 		if (!this->bOpen) return false;
 
-		try
+		if (!this->index.isEmpty())
 		{
-			this->playback.seek_timestamp(std::chrono::microseconds(usecs), K4A_PLAYBACK_SEEK_BEGIN);
-			this->lastFrameSecs = 0;
+			// Land on the first capture at or after the time.
+			const auto timestamp = std::chrono::microseconds(this->config.start_timestamp_offset_usec + usecs);
+			return this->seekFrame(this->index.findFrame(timestamp));
 		}
-		catch (const k4a::error& e)
+
+		// The reader drops what it read ahead and carries on from there.
+		this->reader.seek(std::chrono::microseconds(usecs));
+
+		return true;
+	}
+
+	bool Playback::seekFrame(size_t frame)
+	{
+		if (!this->bOpen) return false;
+
+		if (frame >= this->index.getFrameCount())
 		{
-			ofLogError(__FUNCTION__) << e.what();
+			ofLogError(__FUNCTION__) << "Frame " << frame << " out of range, the index has " << this->index.getFrameCount() << " frames!";
 			return false;
 		}
 
+		this->reader.seek(this->index.getFrameSeekTimestamp(frame), K4A_PLAYBACK_SEEK_DEVICE_TIME);
+
 		return true;
 	}
 
+	bool Playback::hasIndex() const
+	{
+		return !this->index.isEmpty();
+	}
+
+	size_t Playback::getFrameCount() const
+	{
+		return this->index.getFrameCount();
+	}
+
+	std::chrono::microseconds Playback::getFrameTimestamp(size_t frame) const
+	{
+		return this->index.getFrameTimestamp(frame);
+	}
+
+	std::vector<uint8_t> Playback::getRawCalibration() const
+	{
+		try
+		{
+			return this->playback.get_raw_calibration();
+		}
+		catch (const k4a::error& e)
+		{
+			ofLogError(__FUNCTION__) << e.what();
+			return std::vector<uint8_t>();
+		}
+	}
+
 	bool Playback::updateCapture()
 	{
-		float nextFrameSecs = lastFrameSecs + 1 / static_cast<float>(this->getFramerate());
-		if (this->bPaused || ofGetElapsedTimef() < nextFrameSecs)
+		if (this->bGrouped)
 		{
-			// Not ready for another frame yet.
+			// The group reads and paces, pausing is up to it too.
+			if (!this->takeGroupCapture()) return false;
+
+			this->applyReadCapture();
+			return true;
+		}
+
+		if (this->bPaused)
+		{
+			std::this_thread::sleep_for(PlaybackClock::MAX_SLEEP);
 			return false;
 		}
 
-		try
+		if (this->bHoldingCapture && this->readCapture.generation != this->reader.getGeneration())
 		{
-			if (this->playback.get_next_capture(&this->capture))
-			{
-				lastFrameSecs = ofGetElapsedTimef();
-				return true;
-			}
-			else if (this->bLoops)
-			{
-				// Rewind and try again.
-				this->seekUsecs(0);
-				return this->updateCapture();
-			}
-			else
+			// Read before a seek.
+			this->bHoldingCapture = false;
+		}
+
+		if (!this->bHoldingCapture)
+		{
+			if (!this->reader.pop(this->readCapture, PlaybackClock::MAX_SLEEP))
 			{
-				// Stop.
-				this->stopPlayback();
+				if (this->reader.isFinished())
+				{
+					// Stop.
+					this->stopPlayback();
+				}
+
+				// Nothing read ahead yet.
 				return false;
 			}
+
+			this->bHoldingCapture = true;
 		}
-		catch (const k4a::error& e)
+
+		if (!this->bFreeRun && !this->clock.wait(this->readCapture.timestamp, this->readCapture.loop, this->getFramerate()))
 		{
-			ofLogError(__FUNCTION__) << e.what();
+			// Not ready for this capture yet.
 			return false;
 		}
+
+		this->bHoldingCapture = false;
+
+		this->applyReadCapture();
+		return true;
+	}
+
+	bool Playback::takeGroupCapture()
+	{
+		std::unique_lock<std::mutex> lock(this->groupMutex);
+
+		if (!this->bGroupCaptureReady)
+		{
+			this->groupCondition.wait_for(lock, PlaybackClock::MAX_SLEEP, [this]
+			{
+				return this->bGroupCaptureReady;
+			});
+		}
+
+		if (!this->bGroupCaptureReady) return false;
+
+		std::swap(this->readCapture, this->groupCapture);
+		this->bGroupCaptureReady = false;
+
+		lock.unlock();
+		this->groupCondition.notify_all();
+
+		return true;
+	}
+
+	bool Playback::pushGroupCapture(PlaybackCapture& capture, std::chrono::microseconds timeout)
+	{
+		std::unique_lock<std::mutex> lock(this->groupMutex);
+
+		if (this->bGroupCaptureReady)
+		{
+			this->groupCondition.wait_for(lock, timeout, [this]
+			{
+				return !this->bGroupCaptureReady;
+			});
+		}
+
+		if (this->bGroupCaptureReady) return false;
+
+		std::swap(this->groupCapture, capture);
+		this->bGroupCaptureReady = true;
+
+		lock.unlock();
+		this->groupCondition.notify_all();
+
+		return true;
+	}
+
+	void Playback::applyReadCapture()
+	{
+		this->capture = std::move(this->readCapture.capture);
+
+		if (this->readCapture.bColorDecoded)
+		{
+			// Hand the decoded pixels over, the reader gets the old ones back on the next pop.
+			this->decodedColorPix.swap(this->readCapture.colorPix);
+			this->bColorDecoded = true;
+		}
+
+		if (this->readCapture.bHasSkeletons)
+		{
+			// Skeletons were matched to the depth image, which is what the tracker saw.
+			BodyFrame& frame = this->skeletonBuffer.getBack();
+			frame.bodySkeletons.swap(this->readCapture.bodySkeletons);
+			frame.timestamp = this->readCapture.timestamp;
+			this->skeletonBuffer.publish();
+		}
+	}
+
+	void Playback::update(ofEventArgs& args)
+	{
+		Stream::update(args);
+
+		if (this->bReadSkeletons)
+		{
+			this->skeletonBuffer.swapFront();
+		}
+	}
+
+	bool Playback::hasSkeletonTrack() const
+	{
+		return this->bHasSkeletonTrack;
+	}
+
+	std::shared_ptr<const Frame> Playback::pollFrame()
+	{
+		if (this->bHeadless && this->bReadSkeletons)
+		{
+			this->skeletonBuffer.swapFront();
+		}
+
+		return Stream::pollFrame();
+	}
+
+	size_t Playback::getNumBodies() const
+	{
+		return this->getBodySkeletons().size();
+	}
+
+	const std::vector<BodySkeleton>& Playback::getBodySkeletons() const
+	{
+		if (this->bodyTracker.isTracking() || !this->bReadSkeletons)
+		{
+			return Stream::getBodySkeletons();
+		}
+
+		return this->skeletonBuffer.getFront().bodySkeletons;
 	}
 
 	std::string Playback::readTag(const std::string& name)
@@ -262,6 +547,11 @@ namespace ofxAzureKinect
 		return this->config.subordinate_delay_off_master_usec;
 	}
 
+	bool Playback::isCached() const
+	{
+		return this->reader.isCached();
+	}
+
 	float Playback::getDurationSecs() const
 	{
 		return getDurationUsecs() / 1000000.0f;
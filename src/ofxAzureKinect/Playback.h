@@ -1,11 +1,19 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <string>
 
 #include <k4arecord/playback.hpp>
 
+#include "BodyTracker.h"
+#include "PlaybackClock.h"
+#include "PlaybackIndex.h"
+#include "PlaybackReader.h"
 #include "Stream.h"
+#include "TripleBuffer.h"
 #include "Types.h"
 
 namespace ofxAzureKinect
@@ -20,17 +28,66 @@ namespace ofxAzureKinect
 
 		bool autoloop;
 
+		// Number of threads decoding MJPEG color, 0 decodes on the read-ahead thread.
+		size_t jpegDecodeThreads;
+
+		// Decode MJPEG color at 1/2, 1/4 or 1/8 size, color pixels and texture are sized to match.
+		int jpegDecodeDownscale;
+
+		// Number of threads building the point cloud, including the playback thread.
+		size_t pointCloudThreads;
+
+		// Keep the world tables on disk and load them back on later starts with the same calibration.
+		bool cacheWorldTables;
+
+		// Store the world tables as half floats, at half the memory and with GL_RG16F textures.
+		bool halfFloatWorldTables;
+
+		// Split the point cloud by the body tracker's body index map, see Stream::getBodyPointRanges().
+		// Uses the latest tracking result, which trails the depth frame by the tracker latency, see Stream::getBodyPointRangesTimestamp().
+		// Needs a depth sized point cloud, color sized clouds are built whole.
+		bool bodyPointClouds;
+
+		// Keep the background points in the point cloud when splitting by body.
+		bool backgroundPointCloud;
+
+		// Skip all GL work and the update listener, frames are picked up with pollFrame() or a frame callback instead.
+		bool headless;
+
+		// Read the skeletons written by the recorder and serve them when the body tracker isn't running.
+		bool readSkeletons;
+
+		// Captures read and decoded ahead on a separate thread, by count and by memory (0 for no memory limit).
+		size_t readAheadCaptures;
+		size_t readAheadMegabytes;
+
+		// Playback speed, from 0.1 to 16 times real time, paced on the capture device timestamps.
+		float rate;
+
+		// Deliver captures as fast as they can be read and processed, ignoring timestamps, for batch jobs.
+		bool freeRun;
+
+		// Keep short looping clips in memory after the first pass, see PlaybackCacheMode.
+		// Recordings larger than the limit (0 for none) keep playing from disk.
+		PlaybackCacheMode cacheMode;
+		size_t cacheMaxMegabytes;
+
 		PlaybackSettings();
 	};
 
 	class Playback 
 		: public Stream
 	{
+		friend class PlaybackGroup;
+
 	public:
 		Playback();
 		~Playback();
 
-		bool open(std::string filepath);
+		// The index maps frame numbers to capture timestamps for exact seeks. Building it reads
+		// through the whole recording on the calling thread, which takes a while on long recordings.
+		// Caching keeps it in a .idx file next to the recording, so the folder has to be writable.
+		bool open(std::string filepath, bool buildIndex = false, bool cacheIndex = false);
 		bool close();
 
 		bool startPlayback(PlaybackSettings playbackSettings = PlaybackSettings());
@@ -39,12 +96,32 @@ namespace ofxAzureKinect
 		void setPaused(bool paused);
 		bool isPaused() const;
 
+		void setRate(float rate);
+		float getRate() const;
+
+		void setFreeRun(bool freeRun);
+		bool isFreeRun() const;
+
 		bool seekPct(float pct);
 		bool seekSecs(float seconds);
 		bool seekUsecs(long long usecs);
 
+		// Index only, frame numbers count captures from the start of the recording.
+		bool seekFrame(size_t frame);
+
+		bool hasIndex() const;
+		size_t getFrameCount() const;
+		std::chrono::microseconds getFrameTimestamp(size_t frame) const;
+
 		std::string readTag(const std::string& name);
 
+		bool hasSkeletonTrack() const;
+
+		std::shared_ptr<const Frame> pollFrame() override;
+
+		size_t getNumBodies() const override;
+		const std::vector<BodySkeleton>& getBodySkeletons() const override;
+
 		DepthMode getDepthMode() const override;
 		ImageFormat getColorFormat() const override;
 		ColorResolution getColorResolution() const override;
@@ -54,21 +131,60 @@ namespace ofxAzureKinect
 		uint32_t getDepthDelayUsec() const override;
 		uint32_t getSubordinateDelayUsec() const override;
 
+		// The whole recording is in memory, loops and seeks no longer touch the disk.
+		bool isCached() const;
+
 		float getDurationSecs() const;
 		long long getDurationUsecs() const;
 
 	protected:
+		std::vector<uint8_t> getRawCalibration() const override;
+
 		bool updateCapture() override;
 
+		void update(ofEventArgs& args) override;
+
+		// Takes the capture handed over by the group, waiting a short while for one.
+		bool takeGroupCapture();
+
+		// Hands a capture over to the capture thread, once it has taken the previous one.
+		// Swaps with the capture, so the caller gets the previous one's buffers back.
+		bool pushGroupCapture(PlaybackCapture& capture, std::chrono::microseconds timeout);
+
+		// Moves the read capture into the stream.
+		void applyReadCapture();
+
 	private:
 		bool bUpdateDepth;
 		bool bLoops;
 		bool bPaused;
+		bool bHasSkeletonTrack;
+		bool bReadSkeletons;
 
-		float lastFrameSecs;
 		std::chrono::microseconds duration;
 
 		k4a_record_configuration_t config;
 		k4a::playback playback;
+
+		PlaybackIndex index;
+
+		// Reads captures and skeletons ahead with its own handle on the file.
+		PlaybackReader reader;
+		PlaybackCapture readCapture;
+
+		PlaybackClock clock;
+		std::atomic<bool> bFreeRun;
+
+		// The capture was popped from the reader and waits for its due time.
+		bool bHoldingCapture;
+
+		// Set while a PlaybackGroup reads and paces the recording, and hands the captures over.
+		bool bGrouped;
+		std::mutex groupMutex;
+		std::condition_variable groupCondition;
+		PlaybackCapture groupCapture;
+		bool bGroupCaptureReady;
+
+		TripleBuffer<BodyFrame> skeletonBuffer;
 	};
 }
@@ -0,0 +1,89 @@
+#include "PlaybackClock.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "ofMath.h"
+
+// Running this far behind restarts the clock instead of rushing through the backlog.
+const int64_t MAX_LAG_IN_US = 250000;
+
+namespace ofxAzureKinect
+{
+	const float PlaybackClock::MIN_RATE = 0.1f;
+	const float PlaybackClock::MAX_RATE = 16.f;
+
+	const std::chrono::microseconds PlaybackClock::MAX_SLEEP = std::chrono::microseconds(5000);
+
+	PlaybackClock::PlaybackClock()
+		: rate(1.f)
+		, bReset(true)
+		, clockLoop(0)
+		, clockTimestamp(0)
+		, lastTimestamp(0)
+	{}
+
+	void PlaybackClock::setRate(float rate)
+	{
+		this->rate = ofClamp(rate, MIN_RATE, MAX_RATE);
+		this->bReset = true;
+	}
+
+	float PlaybackClock::getRate() const
+	{
+		return this->rate;
+	}
+
+	void PlaybackClock::reset()
+	{
+		this->bReset = true;
+	}
+
+	void PlaybackClock::clear()
+	{
+		this->bReset = true;
+		this->lastTimestamp = std::chrono::microseconds(0);
+	}
+
+	bool PlaybackClock::wait(std::chrono::microseconds timestamp, uint64_t loop, uint32_t framerate)
+	{
+		const auto now = std::chrono::steady_clock::now();
+		const float rate = this->rate;
+
+		if (this->bReset.exchange(false) || loop != this->clockLoop || timestamp < this->lastTimestamp)
+		{
+			// Restart after a pause, rate change, loop or seek, one frame after the last one.
+			auto startTime = now;
+			if (this->lastTimestamp.count() > 0)
+			{
+				const auto framePeriod = std::chrono::duration<double, std::micro>(1000000.0 / framerate / rate);
+				startTime = std::max(now, this->lastTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(framePeriod));
+			}
+			this->clockTime = startTime;
+			this->clockTimestamp = timestamp;
+			this->clockLoop = loop;
+		}
+
+		const auto offset = std::chrono::duration<double, std::micro>((timestamp - this->clockTimestamp).count() / static_cast<double>(rate));
+		auto dueTime = this->clockTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(offset);
+
+		if (now < dueTime)
+		{
+			const auto remaining = std::chrono::duration_cast<std::chrono::microseconds>(dueTime - now);
+			std::this_thread::sleep_for(std::min(remaining, MAX_SLEEP));
+			if (remaining > MAX_SLEEP) return false;
+		}
+		else if (std::chrono::duration_cast<std::chrono::microseconds>(now - dueTime).count() > MAX_LAG_IN_US)
+		{
+			// Too far behind, pick up the clock from here.
+			this->clockTime = now;
+			this->clockTimestamp = timestamp;
+			dueTime = now;
+		}
+
+		this->lastTime = dueTime;
+		this->lastTimestamp = timestamp;
+
+		return true;
+	}
+}
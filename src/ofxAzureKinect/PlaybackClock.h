@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+namespace ofxAzureKinect
+{
+	// Maps capture device timestamps to wall time from a start point, scaled by a rate.
+	// The clock restarts one frame after the last capture on a reset, a new loop or seek,
+	// or a timestamp going backwards, and picks up from the current time when it falls too far behind.
+	class PlaybackClock
+	{
+	public:
+		static const float MIN_RATE;
+		static const float MAX_RATE;
+
+		// Longest wait() sleeps at once, so the caller stays responsive to stops, seeks and rate changes.
+		static const std::chrono::microseconds MAX_SLEEP;
+
+		PlaybackClock();
+
+		// Clamped to the supported range, restarts the clock.
+		void setRate(float rate);
+		float getRate() const;
+
+		// Restart at the next capture, e.g. after a pause. Safe to call from any thread.
+		void reset();
+
+		// Also forget the last capture, so the next one is due right away.
+		void clear();
+
+		// Sleeps towards the capture's due time, up to MAX_SLEEP. Returns true once it's due.
+		bool wait(std::chrono::microseconds timestamp, uint64_t loop, uint32_t framerate);
+
+	private:
+		std::atomic<float> rate;
+		std::atomic<bool> bReset;
+
+		uint64_t clockLoop;
+		std::chrono::steady_clock::time_point clockTime;
+		std::chrono::microseconds clockTimestamp;
+		std::chrono::steady_clock::time_point lastTime;
+		std::chrono::microseconds lastTimestamp;
+	};
+}
@@ -0,0 +1,452 @@
+#include "PlaybackGroup.h"
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+#include "ofLog.h"
+#include "ofMath.h"
+
+namespace ofxAzureKinect
+{
+	PlaybackGroup::PlaybackGroup()
+		: bOpen(false)
+		, bLoops(true)
+		, bPaused(false)
+		, bFreeRun(false)
+		, bFinished(false)
+		, masterIndex(0)
+		, framerate(30)
+		, startTimestamp(0)
+		, endTimestamp(0)
+		, loop(0)
+	{}
+
+	PlaybackGroup::~PlaybackGroup()
+	{
+		this->close();
+	}
+
+	bool PlaybackGroup::open(const std::vector<std::string>& filepaths, bool buildIndex, bool cacheIndex)
+	{
+		if (this->bOpen) return false;
+
+		if (filepaths.empty())
+		{
+			ofLogError(__FUNCTION__) << "File paths cannot be empty!";
+			return false;
+		}
+
+		for (const auto& filepath : filepaths)
+		{
+			Member member;
+			member.playback = std::make_shared<Playback>();
+			member.playback->bGrouped = true;
+			member.offset = std::chrono::microseconds(0);
+			member.bHolding = false;
+
+			if (!member.playback->open(filepath, buildIndex, cacheIndex))
+			{
+				this->members.clear();
+				return false;
+			}
+
+			this->members.push_back(std::move(member));
+		}
+
+		// Subordinates take their captures their delay after the master.
+		size_t numMasters = 0;
+		this->masterIndex = 0;
+		for (size_t i = 0; i < this->members.size(); ++i)
+		{
+			const auto& playback = this->members[i].playback;
+			switch (playback->getWiredSyncMode())
+			{
+			case K4A_WIRED_SYNC_MODE_MASTER:
+				this->masterIndex = i;
+				++numMasters;
+				break;
+
+			case K4A_WIRED_SYNC_MODE_SUBORDINATE:
+				this->members[i].offset = std::chrono::microseconds(playback->getSubordinateDelayUsec());
+				break;
+
+			case K4A_WIRED_SYNC_MODE_STANDALONE:
+			default:
+				ofLogWarning(__FUNCTION__) << "Recording " << i << " is standalone, aligning on its device timestamps as is.";
+				break;
+			}
+		}
+
+		if (numMasters != 1)
+		{
+			ofLogWarning(__FUNCTION__) << "Expected one master recording, found " << numMasters << ".";
+		}
+
+		this->framerate = this->members[this->masterIndex].playback->getFramerate();
+		for (const auto& member : this->members)
+		{
+			if (member.playback->getFramerate() != this->framerate)
+			{
+				ofLogError(__FUNCTION__) << "Recordings must share a frame rate, found " << member.playback->getFramerate() << " and " << this->framerate << " fps!";
+				this->members.clear();
+				return false;
+			}
+		}
+
+		this->startTimestamp = std::chrono::microseconds(std::numeric_limits<int64_t>::max());
+		this->endTimestamp = std::chrono::microseconds(std::numeric_limits<int64_t>::min());
+		for (const auto& member : this->members)
+		{
+			const auto start = std::chrono::microseconds(member.playback->config.start_timestamp_offset_usec) - member.offset;
+			this->startTimestamp = std::min(this->startTimestamp, start);
+			this->endTimestamp = std::max(this->endTimestamp, start + std::chrono::microseconds(member.playback->getDurationUsecs()));
+		}
+
+		ofLogNotice(__FUNCTION__) << "Open success, " << this->members.size() << " recordings with the master at " << this->masterIndex;
+
+		this->bOpen = true;
+		return true;
+	}
+
+	bool PlaybackGroup::close()
+	{
+		if (!this->bOpen) return false;
+
+		this->stopPlayback();
+
+		// Closes the playbacks, unless the app still holds on to them.
+		this->members.clear();
+
+		this->bOpen = false;
+		return true;
+	}
+
+	bool PlaybackGroup::isOpen() const
+	{
+		return this->bOpen;
+	}
+
+	bool PlaybackGroup::startPlayback(PlaybackSettings playbackSettings)
+	{
+		if (!this->bOpen)
+		{
+			ofLogError(__FUNCTION__) << "Open files before starting playback!";
+			return false;
+		}
+
+		if (this->isThreadRunning())
+		{
+			ofLogError(__FUNCTION__) << "Already playing, stop first!";
+			return false;
+		}
+
+		// The group rewinds all recordings together.
+		this->bLoops = playbackSettings.autoloop;
+		playbackSettings.autoloop = false;
+
+		for (auto& member : this->members)
+		{
+			member.capture.clear();
+			member.bHolding = false;
+
+			if (!member.playback->startPlayback(playbackSettings))
+			{
+				for (auto& started : this->members)
+				{
+					started.playback->stopPlayback();
+				}
+				return false;
+			}
+		}
+
+		this->clock.setRate(playbackSettings.rate);
+		this->clock.clear();
+		this->bFreeRun = playbackSettings.freeRun;
+		this->bFinished = false;
+
+		this->startThread();
+
+		return true;
+	}
+
+	bool PlaybackGroup::stopPlayback()
+	{
+		if (!this->isThreadRunning()) return false;
+
+		// Stop handing captures over before the playbacks stop taking them.
+		this->stopThread();
+		this->waitForThread(false);
+
+		for (auto& member : this->members)
+		{
+			member.playback->stopPlayback();
+			member.capture.clear();
+			member.bHolding = false;
+		}
+
+		return true;
+	}
+
+	bool PlaybackGroup::isPlaying() const
+	{
+		return this->isThreadRunning();
+	}
+
+	bool PlaybackGroup::isFinished() const
+	{
+		return this->bFinished;
+	}
+
+	void PlaybackGroup::setPaused(bool paused)
+	{
+		if (this->bPaused && !paused)
+		{
+			// Carry on from where we stopped instead of catching up.
+			this->clock.reset();
+		}
+		this->bPaused = paused;
+	}
+
+	bool PlaybackGroup::isPaused() const
+	{
+		return this->bPaused;
+	}
+
+	void PlaybackGroup::setRate(float rate)
+	{
+		this->clock.setRate(rate);
+	}
+
+	float PlaybackGroup::getRate() const
+	{
+		return this->clock.getRate();
+	}
+
+	void PlaybackGroup::setFreeRun(bool freeRun)
+	{
+		this->bFreeRun = freeRun;
+		this->clock.reset();
+	}
+
+	bool PlaybackGroup::isFreeRun() const
+	{
+		return this->bFreeRun;
+	}
+
+	bool PlaybackGroup::seekPct(float pct)
+	{
+		return this->seekUsecs(ofMap(pct, 0, 1, 0, this->getDurationUsecs(), true));
+	}
+
+	bool PlaybackGroup::seekSecs(float seconds)
+	{
+		return this->seekUsecs(seconds * 1000000ll);
+	}
+
+	bool PlaybackGroup::seekUsecs(long long usecs)
+	{
+		if (!this->bOpen) return false;
+
+		this->seekAligned(this->startTimestamp + std::chrono::microseconds(usecs));
+
+		return true;
+	}
+
+	void PlaybackGroup::seekAligned(std::chrono::microseconds timestamp)
+	{
+		// Seeks from the app and loops from the group thread don't interleave.
+		std::unique_lock<std::mutex> lock(this->seekMutex);
+
+		for (auto& member : this->members)
+		{
+			Playback& playback = *member.playback;
+			const auto deviceTime = timestamp + member.offset;
+
+			const auto end = std::chrono::microseconds(playback.config.start_timestamp_offset_usec + playback.getDurationUsecs());
+			if (end < deviceTime)
+			{
+				// Ended before the time, don't let it land on its last capture.
+				playback.reader.finish();
+			}
+			else if (playback.hasIndex())
+			{
+				// Land every recording on an exact capture.
+				playback.reader.seek(playback.index.getFrameSeekTimestamp(playback.index.findFrame(deviceTime)), K4A_PLAYBACK_SEEK_DEVICE_TIME);
+			}
+			else
+			{
+				playback.reader.seek(deviceTime, K4A_PLAYBACK_SEEK_DEVICE_TIME);
+			}
+		}
+
+		++this->loop;
+		this->bFinished = false;
+	}
+
+	size_t PlaybackGroup::getNumPlaybacks() const
+	{
+		return this->members.size();
+	}
+
+	std::shared_ptr<Playback> PlaybackGroup::getPlayback(size_t idx) const
+	{
+		if (idx >= this->members.size()) return nullptr;
+		return this->members[idx].playback;
+	}
+
+	size_t PlaybackGroup::getMasterIndex() const
+	{
+		return this->masterIndex;
+	}
+
+	std::chrono::microseconds PlaybackGroup::getDeviceOffset(size_t idx) const
+	{
+		if (idx >= this->members.size()) return std::chrono::microseconds(0);
+		return this->members[idx].offset;
+	}
+
+	void PlaybackGroup::setCaptureSetCallback(std::function<void(const PlaybackCaptureSet&)> callback)
+	{
+		std::unique_lock<std::mutex> lock(this->callbackMutex);
+		this->captureSetCallback = callback;
+	}
+
+	float PlaybackGroup::getDurationSecs() const
+	{
+		return this->getDurationUsecs() / 1000000.0f;
+	}
+
+	long long PlaybackGroup::getDurationUsecs() const
+	{
+		if (!this->bOpen) return 0;
+		return (this->endTimestamp - this->startTimestamp).count();
+	}
+
+	void PlaybackGroup::threadedFunction()
+	{
+		// Captures within half a frame of each other were taken on the same sync pulse.
+		const auto tolerance = std::chrono::microseconds(1000000 / this->framerate / 2);
+
+		this->captureSet.captures.resize(this->members.size());
+
+		while (this->isThreadRunning())
+		{
+			if (this->bPaused)
+			{
+				std::this_thread::sleep_for(PlaybackClock::MAX_SLEEP);
+				continue;
+			}
+
+			const uint64_t loop = this->loop;
+
+			// Every recording that isn't done needs its next capture before picking the set.
+			bool bWaiting = false;
+			bool bDone = true;
+			for (auto& member : this->members)
+			{
+				PlaybackReader& reader = member.playback->reader;
+
+				if (member.bHolding && member.capture.generation != reader.getGeneration())
+				{
+					// Read before a seek.
+					member.bHolding = false;
+				}
+
+				if (!member.bHolding)
+				{
+					member.bHolding = reader.pop(member.capture, PlaybackClock::MAX_SLEEP);
+				}
+
+				if (member.bHolding)
+				{
+					bDone = false;
+				}
+				else if (!reader.isFinished())
+				{
+					bWaiting = true;
+					bDone = false;
+				}
+			}
+
+			if (bWaiting) continue;
+
+			if (bDone)
+			{
+				if (this->bLoops)
+				{
+					this->seekAligned(this->startTimestamp);
+				}
+				else
+				{
+					// Hold on to the last set until a seek.
+					this->bFinished = true;
+					std::this_thread::sleep_for(PlaybackClock::MAX_SLEEP);
+				}
+				continue;
+			}
+
+			// The set is taken at the earliest capture any recording has left.
+			auto timestamp = std::chrono::microseconds(std::numeric_limits<int64_t>::max());
+			for (const auto& member : this->members)
+			{
+				if (member.bHolding)
+				{
+					timestamp = std::min(timestamp, member.capture.timestamp - member.offset);
+				}
+			}
+
+			if (!this->bFreeRun && !this->clock.wait(timestamp, loop, this->framerate))
+			{
+				// Not ready for this set yet.
+				continue;
+			}
+
+			{
+				// A seek since the captures were popped makes some of them stale, start over.
+				std::unique_lock<std::mutex> lock(this->seekMutex);
+				if (this->loop != loop) continue;
+
+				this->captureSet.timestamp = timestamp;
+				for (size_t i = 0; i < this->members.size(); ++i)
+				{
+					const Member& member = this->members[i];
+					const bool bInSet = member.bHolding && member.capture.timestamp - member.offset - timestamp <= tolerance;
+					this->captureSet.captures[i] = bInSet ? member.capture.capture : k4a::capture();
+				}
+			}
+
+			{
+				std::unique_lock<std::mutex> lock(this->callbackMutex);
+				if (this->captureSetCallback)
+				{
+					this->captureSetCallback(this->captureSet);
+				}
+			}
+
+			// Seeks wait for the set to be handed over, and a seek from the callback drops it.
+			std::unique_lock<std::mutex> lock(this->seekMutex);
+			for (size_t i = 0; i < this->members.size(); ++i)
+			{
+				if (!this->captureSet.captures[i]) continue;
+				this->captureSet.captures[i].reset();
+
+				// Don't let any playback fall behind the others, wait for it to take its previous capture.
+				Member& member = this->members[i];
+				bool bPushed = false;
+				while (this->loop == loop && !(bPushed = member.playback->pushGroupCapture(member.capture, PlaybackClock::MAX_SLEEP)))
+				{
+					// Let seeks through while the playback catches up.
+					lock.unlock();
+					if (!this->isThreadRunning()) return;
+					lock.lock();
+				}
+
+				if (bPushed)
+				{
+					member.bHolding = false;
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <k4a/k4a.hpp>
+
+#include "ofThread.h"
+
+#include "Playback.h"
+#include "PlaybackClock.h"
+#include "PlaybackReader.h"
+
+namespace ofxAzureKinect
+{
+	// Captures from the recordings of a group that were taken together.
+	struct PlaybackCaptureSet
+	{
+		// Device time on the master's clock.
+		std::chrono::microseconds timestamp;
+
+		// One per recording in the order they were opened, empty if a recording has nothing at this time.
+		std::vector<k4a::capture> captures;
+	};
+
+	// Plays back the recordings of wired sync devices together.
+	// Device timestamps are aligned on the master's clock, taking each subordinate's
+	// delay off the master into account. One thread reads from every recording, paces
+	// on the aligned timestamps and hands each capture set over to the playbacks,
+	// which process and draw them as usual. Seeks and loops move all recordings together.
+	class PlaybackGroup
+		: public ofThread
+	{
+	public:
+		PlaybackGroup();
+		~PlaybackGroup();
+
+		// The master can be anywhere in the list. Recordings without wired sync are aligned as is.
+		// Indexing lands every recording on an exact capture when seeking, see Playback::open().
+		bool open(const std::vector<std::string>& filepaths, bool buildIndex = false, bool cacheIndex = false);
+		bool close();
+
+		bool isOpen() const;
+
+		// The settings apply to every playback.
+		bool startPlayback(PlaybackSettings playbackSettings = PlaybackSettings());
+		bool stopPlayback();
+
+		bool isPlaying() const;
+
+		// All recordings reached their end without looping.
+		bool isFinished() const;
+
+		void setPaused(bool paused);
+		bool isPaused() const;
+
+		void setRate(float rate);
+		float getRate() const;
+
+		void setFreeRun(bool freeRun);
+		bool isFreeRun() const;
+
+		// Times are from the earliest capture of any recording.
+		bool seekPct(float pct);
+		bool seekSecs(float seconds);
+		bool seekUsecs(long long usecs);
+
+		size_t getNumPlaybacks() const;
+		std::shared_ptr<Playback> getPlayback(size_t idx) const;
+
+		size_t getMasterIndex() const;
+
+		// Added to master device time to get the recording's device time.
+		std::chrono::microseconds getDeviceOffset(size_t idx) const;
+
+		// Called on the group thread for each set, before the playbacks get their captures.
+		void setCaptureSetCallback(std::function<void(const PlaybackCaptureSet&)> callback);
+
+		float getDurationSecs() const;
+		long long getDurationUsecs() const;
+
+	protected:
+		void threadedFunction() override;
+
+		// Moves every recording to the first capture at or after the master device time.
+		void seekAligned(std::chrono::microseconds timestamp);
+
+	private:
+		struct Member
+		{
+			std::shared_ptr<Playback> playback;
+			std::chrono::microseconds offset;
+
+			// Next capture, popped from the reader and waiting for its set.
+			PlaybackCapture capture;
+			bool bHolding;
+		};
+
+		bool bOpen;
+		bool bLoops;
+		std::atomic<bool> bPaused;
+		std::atomic<bool> bFreeRun;
+		std::atomic<bool> bFinished;
+
+		std::vector<Member> members;
+		size_t masterIndex;
+		uint32_t framerate;
+
+		// Master device time of the earliest capture, and of the end of the longest recording.
+		std::chrono::microseconds startTimestamp;
+		std::chrono::microseconds endTimestamp;
+
+		PlaybackClock clock;
+
+		// Bumped by every seek and loop, restarts the clock.
+		std::atomic<uint64_t> loop;
+		std::mutex seekMutex;
+
+		PlaybackCaptureSet captureSet;
+		std::function<void(const PlaybackCaptureSet&)> captureSetCallback;
+		std::mutex callbackMutex;
+	};
+}
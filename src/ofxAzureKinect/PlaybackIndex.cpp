@@ -0,0 +1,227 @@
+#include "PlaybackIndex.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#include "ofFileUtils.h"
+#include "ofLog.h"
+
+namespace
+{
+	const char INDEX_MAGIC[8] = { 'K', '4', 'A', 'I', 'N', 'D', 'E', 'X' };
+	const uint32_t INDEX_VERSION = 1;
+
+	struct IndexHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t reserved;
+		uint64_t key;
+		uint64_t numEntries;
+	};
+	static_assert(sizeof(IndexHeader) == 32, "Unexpected index header size");
+
+	const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+	const uint64_t FNV_PRIME = 1099511628211ULL;
+
+	uint64_t hashValue(uint64_t hash, int64_t value)
+	{
+		const auto bytes = reinterpret_cast<const uint8_t*>(&value);
+		for (size_t i = 0; i < sizeof(value); ++i)
+		{
+			hash ^= bytes[i];
+			hash *= FNV_PRIME;
+		}
+		return hash;
+	}
+}
+
+namespace ofxAzureKinect
+{
+	const size_t PlaybackIndex::INVALID_FRAME = std::numeric_limits<size_t>::max();
+
+	std::chrono::microseconds PlaybackIndex::getCaptureTimestamp(const k4a::capture& capture)
+	{
+		k4a::image img = capture.get_depth_image();
+		if (!img) img = capture.get_color_image();
+		if (!img) img = capture.get_ir_image();
+		return img ? img.get_device_timestamp() : std::chrono::microseconds(0);
+	}
+
+	std::string PlaybackIndex::getFilePath(const std::string& recordingPath)
+	{
+		return recordingPath + ".idx";
+	}
+
+	uint64_t PlaybackIndex::makeKey(const std::string& recordingPath, std::chrono::microseconds recordingLength)
+	{
+		uint64_t hash = FNV_OFFSET_BASIS;
+		hash = hashValue(hash, static_cast<int64_t>(ofFile(recordingPath).getSize()));
+		hash = hashValue(hash, recordingLength.count());
+		return hash;
+	}
+
+	bool PlaybackIndex::build(k4a::playback& playback)
+	{
+		this->clear();
+
+		try
+		{
+			playback.seek_timestamp(std::chrono::microseconds(0), K4A_PLAYBACK_SEEK_BEGIN);
+
+			k4a::capture capture;
+			while (playback.get_next_capture(&capture))
+			{
+				// Seeks land on the first capture with an image at or after the seek time.
+				int64_t seekTimestamp = std::numeric_limits<int64_t>::max();
+				for (const k4a::image& img : { capture.get_depth_image(), capture.get_color_image(), capture.get_ir_image() })
+				{
+					if (img) seekTimestamp = std::min(seekTimestamp, static_cast<int64_t>(img.get_device_timestamp().count()));
+				}
+
+				Entry entry;
+				entry.timestamp = PlaybackIndex::getCaptureTimestamp(capture).count();
+				entry.seekTimestamp = (seekTimestamp == std::numeric_limits<int64_t>::max()) ? entry.timestamp : seekTimestamp;
+				this->entries.push_back(entry);
+			}
+
+			playback.seek_timestamp(std::chrono::microseconds(0), K4A_PLAYBACK_SEEK_BEGIN);
+		}
+		catch (const k4a::error& e)
+		{
+			ofLogError(__FUNCTION__) << e.what();
+			this->clear();
+			return false;
+		}
+
+		return true;
+	}
+
+	bool PlaybackIndex::load(const std::string& filePath, uint64_t key)
+	{
+		this->clear();
+
+		if (!ofFile::doesFileExist(filePath, false)) return false;
+
+		std::ifstream ifs(filePath, std::ios::binary);
+		if (!ifs) return false;
+
+		IndexHeader header;
+		ifs.read(reinterpret_cast<char*>(&header), sizeof(IndexHeader));
+		if (!ifs ||
+			std::memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 ||
+			header.version != INDEX_VERSION ||
+			header.key != key)
+		{
+			ofLogWarning(__FUNCTION__) << "Ignoring stale or corrupt index " << filePath;
+			return false;
+		}
+
+		// Don't trust the count before allocating for it.
+		const std::streamoff entriesBegin = ifs.tellg();
+		ifs.seekg(0, std::ios::end);
+		const std::streamoff entriesSize = ifs.tellg() - entriesBegin;
+		ifs.seekg(entriesBegin);
+		if (!ifs || entriesSize < 0 || header.numEntries > static_cast<uint64_t>(entriesSize) / sizeof(Entry))
+		{
+			ofLogWarning(__FUNCTION__) << "Ignoring truncated index " << filePath;
+			return false;
+		}
+
+		this->entries.resize(header.numEntries);
+		ifs.read(reinterpret_cast<char*>(this->entries.data()), static_cast<std::streamsize>(header.numEntries * sizeof(Entry)));
+		if (!ifs)
+		{
+			ofLogWarning(__FUNCTION__) << "Ignoring truncated index " << filePath;
+			this->clear();
+			return false;
+		}
+
+		return true;
+	}
+
+	bool PlaybackIndex::save(const std::string& filePath, uint64_t key) const
+	{
+		IndexHeader header;
+		std::memset(&header, 0, sizeof(IndexHeader));
+		std::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+		header.version = INDEX_VERSION;
+		header.key = key;
+		header.numEntries = this->entries.size();
+
+		// Write to a temp file first so that a crash never leaves a partial index behind.
+		const std::string tempPath = filePath + ".tmp";
+		{
+			std::ofstream ofs(tempPath, std::ios::binary | std::ios::trunc);
+			if (!ofs)
+			{
+				ofLogWarning(__FUNCTION__) << "Could not open " << tempPath << " for writing";
+				return false;
+			}
+
+			ofs.write(reinterpret_cast<const char*>(&header), sizeof(IndexHeader));
+			ofs.write(reinterpret_cast<const char*>(this->entries.data()), static_cast<std::streamsize>(this->entries.size() * sizeof(Entry)));
+			if (!ofs)
+			{
+				ofLogError(__FUNCTION__) << "Failed writing " << tempPath;
+				ofs.close();
+				std::remove(tempPath.c_str());
+				return false;
+			}
+		}
+
+#ifdef _WIN32
+		// Windows won't rename over an existing file.
+		std::remove(filePath.c_str());
+#endif
+		if (std::rename(tempPath.c_str(), filePath.c_str()) != 0)
+		{
+			ofLogError(__FUNCTION__) << "Could not move " << tempPath << " to " << filePath;
+			std::remove(tempPath.c_str());
+			return false;
+		}
+
+		return true;
+	}
+
+	void PlaybackIndex::clear()
+	{
+		this->entries.clear();
+	}
+
+	bool PlaybackIndex::isEmpty() const
+	{
+		return this->entries.empty();
+	}
+
+	size_t PlaybackIndex::getFrameCount() const
+	{
+		return this->entries.size();
+	}
+
+	std::chrono::microseconds PlaybackIndex::getFrameTimestamp(size_t frame) const
+	{
+		if (frame >= this->entries.size()) return std::chrono::microseconds(0);
+		return std::chrono::microseconds(this->entries[frame].timestamp);
+	}
+
+	std::chrono::microseconds PlaybackIndex::getFrameSeekTimestamp(size_t frame) const
+	{
+		if (frame >= this->entries.size()) return std::chrono::microseconds(0);
+		return std::chrono::microseconds(this->entries[frame].seekTimestamp);
+	}
+
+	size_t PlaybackIndex::findFrame(std::chrono::microseconds timestamp) const
+	{
+		if (this->entries.empty()) return INVALID_FRAME;
+
+		const auto it = std::lower_bound(this->entries.begin(), this->entries.end(), timestamp.count(), [](const Entry& entry, int64_t value)
+		{
+			return entry.timestamp < value;
+		});
+		return std::min(static_cast<size_t>(it - this->entries.begin()), this->entries.size() - 1);
+	}
+}
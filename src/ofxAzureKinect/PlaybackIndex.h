@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <k4arecord/playback.hpp>
+
+namespace ofxAzureKinect
+{
+	// Device timestamps of every capture in a recording, so that frames can be
+	// addressed by number and seeks land on an exact capture.
+	// Built by scanning the recording once, and optionally cached in a file next to it,
+	// keyed by the recording's size and length.
+	class PlaybackIndex
+	{
+	public:
+		static const size_t INVALID_FRAME;
+
+		// Timestamp a capture is known by, from its depth image if it has one.
+		static std::chrono::microseconds getCaptureTimestamp(const k4a::capture& capture);
+
+		static std::string getFilePath(const std::string& recordingPath);
+
+		static uint64_t makeKey(const std::string& recordingPath, std::chrono::microseconds recordingLength);
+
+		// Reads through all captures and rewinds the playback to the start.
+		bool build(k4a::playback& playback);
+
+		bool load(const std::string& filePath, uint64_t key);
+		bool save(const std::string& filePath, uint64_t key) const;
+
+		void clear();
+
+		bool isEmpty() const;
+
+		size_t getFrameCount() const;
+
+		// Returns 0 if the frame is out of range.
+		std::chrono::microseconds getFrameTimestamp(size_t frame) const;
+
+		// Device time to seek to for the frame, the earliest image timestamp in its capture.
+		std::chrono::microseconds getFrameSeekTimestamp(size_t frame) const;
+
+		// First frame at or after the timestamp, clamped to the last frame.
+		size_t findFrame(std::chrono::microseconds timestamp) const;
+
+	private:
+		struct Entry
+		{
+			int64_t timestamp;
+			int64_t seekTimestamp;
+		};
+
+		std::vector<Entry> entries;
+	};
+}
@@ -0,0 +1,672 @@
+#include "PlaybackReader.h"
+
+#include <algorithm>
+
+#include "ofLog.h"
+
+#include "BodySerializer.h"
+#include "PlaybackIndex.h"
+#include "Recorder.h"
+
+namespace ofxAzureKinect
+{
+	PlaybackCapture::PlaybackCapture()
+		: timestamp(0)
+		, bColorDecoded(false)
+		, bHasSkeletons(false)
+		, loop(0)
+		, generation(0)
+		, numBytes(0)
+	{}
+
+	void PlaybackCapture::clear()
+	{
+		this->capture.reset();
+		this->timestamp = std::chrono::microseconds(0);
+		this->bColorDecoded = false;
+		this->bodySkeletons.clear();
+		this->bHasSkeletons = false;
+		this->loop = 0;
+		this->generation = 0;
+		this->numBytes = 0;
+	}
+
+	PlaybackReaderSettings::PlaybackReaderSettings()
+		: maxCaptures(4)
+		, maxMegabytes(0)
+		, decodeColor(true)
+		, jpegDecodeThreads(0)
+		, jpegDecodeDownscale(1)
+		, readSkeletons(true)
+		, autoloop(true)
+		, cacheMode(PLAYBACK_CACHE_NONE)
+		, cacheMaxMegabytes(2048)
+	{}
+
+	PlaybackReader::PlaybackReader()
+		: bOpen(false)
+		, bRunning(false)
+		, recordingLength(0)
+		, bHasSkeletonTrack(false)
+		, bDecodeColor(false)
+		, bReadSkeletons(false)
+		, numQueuedBytes(0)
+		, bSeekRequested(false)
+		, seekTimestamp(0)
+		, seekOrigin(K4A_PLAYBACK_SEEK_BEGIN)
+		, generation(0)
+		, loop(0)
+		, bEndOfFile(false)
+		, jpegDecompressor(tjInitDecompress())
+		, cacheBytes(0)
+		, cachePosition(0)
+		, bAtStart(true)
+		, bCaching(false)
+		, bCacheFailed(false)
+		, bCacheComplete(false)
+	{}
+
+	PlaybackReader::~PlaybackReader()
+	{
+		this->close();
+
+		tjDestroy(this->jpegDecompressor);
+	}
+
+	bool PlaybackReader::open(const std::string& filepath)
+	{
+		if (this->bOpen) return false;
+
+		try
+		{
+			this->playback = k4a::playback::open(filepath.c_str());
+			this->config = this->playback.get_record_configuration();
+			this->recordingLength = this->playback.get_recording_length();
+			this->bHasSkeletonTrack = k4a_playback_check_track_exists(this->playback.handle(), Recorder::SKELETON_TRACK_NAME);
+		}
+		catch (const k4a::error& e)
+		{
+			ofLogError(__FUNCTION__) << e.what();
+
+			this->playback.close();
+
+			return false;
+		}
+
+		this->bSeekRequested = false;
+		this->generation = 0;
+		this->loop = 0;
+		this->bAtStart = true;
+
+		this->bOpen = true;
+		return true;
+	}
+
+	bool PlaybackReader::close()
+	{
+		if (!this->bOpen) return false;
+
+		this->stop();
+
+		this->playback.close();
+		this->clearCache();
+
+		this->bHasSkeletonTrack = false;
+		this->bOpen = false;
+
+		return true;
+	}
+
+	bool PlaybackReader::isOpen() const
+	{
+		return this->bOpen;
+	}
+
+	bool PlaybackReader::start(const PlaybackReaderSettings& settings)
+	{
+		if (!this->bOpen)
+		{
+			ofLogError(__FUNCTION__) << "Open reader before starting!";
+			return false;
+		}
+
+		if (this->bRunning) return false;
+
+		if (settings.cacheMode != this->settings.cacheMode || settings.cacheMaxMegabytes != this->settings.cacheMaxMegabytes ||
+			settings.jpegDecodeDownscale != this->settings.jpegDecodeDownscale || settings.readSkeletons != this->settings.readSkeletons || settings.decodeColor != this->settings.decodeColor)
+		{
+			// The cache was filled with other settings.
+			this->clearCache();
+		}
+
+		this->settings = settings;
+		this->settings.maxCaptures = std::max(settings.maxCaptures, size_t(1));
+
+		this->bDecodeColor = settings.decodeColor && this->config.color_track_enabled && this->config.color_format == K4A_IMAGE_FORMAT_COLOR_MJPG;
+		this->bReadSkeletons = settings.readSkeletons && this->bHasSkeletonTrack;
+
+		if (this->bDecodeColor && settings.jpegDecodeThreads > 0)
+		{
+			this->jpegDecoder.setup(settings.jpegDecodeThreads, settings.jpegDecodeDownscale);
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+			this->captures.clear();
+			this->numQueuedBytes = 0;
+			this->bEndOfFile = false;
+			this->bRunning = true;
+		}
+		this->thread = std::thread(&PlaybackReader::readerFunction, this);
+
+		return true;
+	}
+
+	bool PlaybackReader::stop()
+	{
+		if (!this->bRunning) return false;
+
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+			this->bRunning = false;
+		}
+		this->condition.notify_all();
+		this->readyCondition.notify_all();
+		this->thread.join();
+
+		// Pick up from the first capture that was read but never played on the next start.
+		std::chrono::microseconds resumeTimestamp(0);
+		if (!this->captures.empty())
+		{
+			resumeTimestamp = this->captures.front().timestamp;
+		}
+		else if (!this->pendingCaptures.empty())
+		{
+			resumeTimestamp = this->pendingCaptures.front().capture.timestamp;
+		}
+
+		this->clearPending();
+		this->jpegDecoder.close();
+
+		this->captures.clear();
+		this->numQueuedBytes = 0;
+		this->skeletonBlock.reset();
+
+		if (resumeTimestamp.count() > 0 && !this->bSeekRequested)
+		{
+			this->seek(resumeTimestamp, K4A_PLAYBACK_SEEK_DEVICE_TIME);
+		}
+
+		return true;
+	}
+
+	bool PlaybackReader::isRunning() const
+	{
+		return this->bRunning;
+	}
+
+	bool PlaybackReader::pop(PlaybackCapture& capture, std::chrono::microseconds timeout)
+	{
+		std::unique_lock<std::mutex> lock(this->mutex);
+
+		if (this->captures.empty() && timeout.count() > 0)
+		{
+			this->readyCondition.wait_for(lock, timeout, [this]
+			{
+				return !this->captures.empty() || (this->bEndOfFile && !this->bSeekRequested) || !this->bRunning;
+			});
+		}
+
+		if (this->captures.empty()) return false;
+
+		this->recycle(capture);
+		capture = std::move(this->captures.front());
+		this->captures.pop_front();
+		this->numQueuedBytes -= capture.numBytes;
+
+		lock.unlock();
+		this->condition.notify_all();
+
+		return true;
+	}
+
+	void PlaybackReader::seek(std::chrono::microseconds timestamp, k4a_playback_seek_origin_t origin)
+	{
+		std::unique_lock<std::mutex> lock(this->mutex);
+
+		this->bSeekRequested = true;
+		this->seekTimestamp = timestamp;
+		this->seekOrigin = origin;
+		++this->generation;
+
+		for (auto& capture : this->captures)
+		{
+			this->recycle(capture);
+		}
+		this->captures.clear();
+		this->numQueuedBytes = 0;
+		this->bEndOfFile = false;
+
+		lock.unlock();
+		this->condition.notify_all();
+	}
+
+	void PlaybackReader::finish()
+	{
+		std::unique_lock<std::mutex> lock(this->mutex);
+
+		// Anything read or requested before this is stale.
+		this->bSeekRequested = false;
+		++this->generation;
+
+		for (auto& capture : this->captures)
+		{
+			this->recycle(capture);
+		}
+		this->captures.clear();
+		this->numQueuedBytes = 0;
+		this->bEndOfFile = true;
+
+		lock.unlock();
+		this->condition.notify_all();
+		this->readyCondition.notify_all();
+	}
+
+	bool PlaybackReader::isFinished() const
+	{
+		std::unique_lock<std::mutex> lock(this->mutex);
+		return this->bEndOfFile && this->captures.empty() && !this->bSeekRequested;
+	}
+
+	uint64_t PlaybackReader::getGeneration() const
+	{
+		std::unique_lock<std::mutex> lock(this->mutex);
+		return this->generation;
+	}
+
+	size_t PlaybackReader::getNumQueuedCaptures() const
+	{
+		std::unique_lock<std::mutex> lock(this->mutex);
+		return this->captures.size();
+	}
+
+	size_t PlaybackReader::getNumQueuedBytes() const
+	{
+		std::unique_lock<std::mutex> lock(this->mutex);
+		return this->numQueuedBytes;
+	}
+
+	bool PlaybackReader::isCached() const
+	{
+		return this->bCacheComplete;
+	}
+
+	void PlaybackReader::readerFunction()
+	{
+		std::unique_lock<std::mutex> lock(this->mutex);
+		while (this->bRunning)
+		{
+			if (this->bSeekRequested)
+			{
+				this->bSeekRequested = false;
+				const auto timestamp = this->seekTimestamp;
+				const auto origin = this->seekOrigin;
+				lock.unlock();
+
+				// Anything still decoding is from before the seek.
+				this->clearPending();
+
+				this->seekTo(timestamp, origin);
+
+				lock.lock();
+				continue;
+			}
+
+			if (this->bEndOfFile || this->isFull())
+			{
+				this->condition.wait(lock);
+				continue;
+			}
+
+			const uint64_t generation = this->generation;
+
+			PlaybackCapture capture;
+			if (!this->freePixels.empty())
+			{
+				capture.colorPix.swap(this->freePixels.back());
+				this->freePixels.pop_back();
+			}
+
+			lock.unlock();
+
+			if (!this->readNext(capture))
+			{
+				// Hand over whatever is still decoding before wrapping or stopping.
+				while (!this->pendingCaptures.empty())
+				{
+					this->popPending();
+				}
+
+				if (this->bCaching && !this->cache.empty())
+				{
+					this->bCaching = false;
+					this->bCacheComplete = true;
+					ofLogNotice(__FUNCTION__) << "Cached " << this->cache.size() << " captures, " << (this->cacheBytes / (1024 * 1024)) << " MB.";
+				}
+
+				if (this->settings.autoloop)
+				{
+					// Rewind here, so the first captures of the next loop are ready when the last ones play.
+					this->seekTo(std::chrono::microseconds(0), K4A_PLAYBACK_SEEK_BEGIN);
+
+					lock.lock();
+				}
+				else
+				{
+					lock.lock();
+					// Unless it was seeked meanwhile, or finished already.
+					this->bEndOfFile = this->bEndOfFile || (generation == this->generation);
+					this->readyCondition.notify_all();
+				}
+				continue;
+			}
+
+			if (this->jpegDecoder.isRunning() && !capture.bColorDecoded)
+			{
+				// Keep one capture in flight per decoder thread, hand over the oldest once they're all busy.
+				PendingCapture pending;
+				pending.decodeTicket = this->jpegDecoder.submit(capture.capture.get_color_image());
+				pending.generation = generation;
+				pending.capture = std::move(capture);
+				this->pendingCaptures.push_back(std::move(pending));
+
+				if (this->pendingCaptures.size() > this->jpegDecoder.getNumThreads())
+				{
+					this->popPending();
+				}
+
+				lock.lock();
+				continue;
+			}
+
+			if (this->bDecodeColor && !capture.bColorDecoded)
+			{
+				const k4a::image colorImg = capture.capture.get_color_image();
+				if (colorImg)
+				{
+					capture.bColorDecoded = JpegDecoder::decode(this->jpegDecompressor, colorImg, capture.colorPix, this->settings.jpegDecodeDownscale);
+				}
+			}
+
+			this->cacheCapture(capture);
+
+			lock.lock();
+			this->push(capture, generation);
+		}
+	}
+
+	void PlaybackReader::seekTo(std::chrono::microseconds timestamp, k4a_playback_seek_origin_t origin)
+	{
+		++this->loop;
+
+		// Same device time the SDK would seek to.
+		std::chrono::microseconds deviceTimestamp = timestamp;
+		if (origin == K4A_PLAYBACK_SEEK_BEGIN)
+		{
+			deviceTimestamp = std::chrono::microseconds(this->config.start_timestamp_offset_usec) + timestamp;
+		}
+		else if (origin == K4A_PLAYBACK_SEEK_END)
+		{
+			deviceTimestamp = std::chrono::microseconds(this->config.start_timestamp_offset_usec) + this->recordingLength + timestamp;
+		}
+
+		if (this->bCacheComplete)
+		{
+			// First cached capture at or after the time, no disk access.
+			const auto it = std::lower_bound(this->cache.begin(), this->cache.end(), deviceTimestamp, [](const PlaybackCapture& cached, std::chrono::microseconds value)
+			{
+				return cached.timestamp < value;
+			});
+			this->cachePosition = it - this->cache.begin();
+			return;
+		}
+
+		// A partial cache only holds a run from the start, start over from here.
+		this->bAtStart = deviceTimestamp.count() <= this->config.start_timestamp_offset_usec;
+		this->bCaching = false;
+		this->cache.clear();
+		this->cacheBytes = 0;
+
+		try
+		{
+			this->playback.seek_timestamp(timestamp, origin);
+		}
+		catch (const k4a::error& e)
+		{
+			ofLogError(__FUNCTION__) << e.what();
+		}
+
+		// The seek moved the skeleton track too, drop the block we were holding.
+		this->skeletonBlock.reset();
+	}
+
+	bool PlaybackReader::readNext(PlaybackCapture& capture)
+	{
+		if (this->bCacheComplete)
+		{
+			if (this->cachePosition >= this->cache.size())
+			{
+				return false;
+			}
+
+			const PlaybackCapture& cached = this->cache[this->cachePosition++];
+			capture.capture = cached.capture;
+			capture.timestamp = cached.timestamp;
+			capture.bodySkeletons = cached.bodySkeletons;
+			capture.bHasSkeletons = cached.bHasSkeletons;
+			capture.numBytes = cached.numBytes;
+			capture.loop = this->loop;
+
+			if (cached.bColorDecoded)
+			{
+				// Copy into the recycled buffer, the cache keeps its own.
+				capture.colorPix.setFromPixels(cached.colorPix.getData(), cached.colorPix.getWidth(), cached.colorPix.getHeight(), OF_PIXELS_BGRA);
+				capture.bColorDecoded = true;
+			}
+
+			return true;
+		}
+
+		if (this->bAtStart)
+		{
+			// Reading from the start, cache the run until the end.
+			this->bAtStart = false;
+			this->bCaching = this->settings.cacheMode != PLAYBACK_CACHE_NONE && !this->bCacheFailed;
+			this->cache.clear();
+			this->cacheBytes = 0;
+		}
+
+		try
+		{
+			if (!this->playback.get_next_capture(&capture.capture))
+			{
+				return false;
+			}
+		}
+		catch (const k4a::error& e)
+		{
+			ofLogError(__FUNCTION__) << e.what();
+			return false;
+		}
+
+		capture.numBytes = 0;
+		const k4a::image depthImg = capture.capture.get_depth_image();
+		const k4a::image colorImg = capture.capture.get_color_image();
+		const k4a::image irImg = capture.capture.get_ir_image();
+		if (depthImg) capture.numBytes += depthImg.get_size();
+		if (colorImg) capture.numBytes += colorImg.get_size();
+		if (irImg) capture.numBytes += irImg.get_size();
+
+		capture.timestamp = PlaybackIndex::getCaptureTimestamp(capture.capture);
+		capture.loop = this->loop;
+
+		if (this->bReadSkeletons)
+		{
+			this->readSkeletons(capture);
+		}
+
+		return true;
+	}
+
+	void PlaybackReader::readSkeletons(PlaybackCapture& capture)
+	{
+		try
+		{
+			while (true)
+			{
+				if (!this->skeletonBlock)
+				{
+					if (!this->playback.get_next_data_block(Recorder::SKELETON_TRACK_NAME, &this->skeletonBlock))
+					{
+						// End of the track.
+						break;
+					}
+				}
+
+				if (this->skeletonBlock.get_device_timestamp_usec() > capture.timestamp)
+				{
+					// Belongs to a later capture, keep it for then.
+					break;
+				}
+
+				// Decode every block up to this capture, the last one wins.
+				if (BodySerializer::readSkeletons(this->skeletonBlock.get_buffer(), this->skeletonBlock.get_buffer_size(), capture.bodySkeletons))
+				{
+					capture.bHasSkeletons = true;
+				}
+
+				this->skeletonBlock.reset();
+			}
+		}
+		catch (const k4a::error& e)
+		{
+			ofLogError(__FUNCTION__) << e.what();
+		}
+	}
+
+	void PlaybackReader::cacheCapture(const PlaybackCapture& capture)
+	{
+		if (!this->bCaching) return;
+
+		const bool bKeepColor = this->settings.cacheMode == PLAYBACK_CACHE_DECODED && capture.bColorDecoded;
+		const size_t numBytes = capture.numBytes + (bKeepColor ? capture.colorPix.getTotalBytes() : 0);
+		if (this->settings.cacheMaxMegabytes > 0 && this->cacheBytes + numBytes > this->settings.cacheMaxMegabytes * 1024 * 1024)
+		{
+			ofLogWarning(__FUNCTION__) << "Recording does not fit in " << this->settings.cacheMaxMegabytes << " MB, reading from disk instead.";
+			this->bCaching = false;
+			this->bCacheFailed = true;
+			this->cache.clear();
+			this->cacheBytes = 0;
+			return;
+		}
+
+		this->cache.emplace_back();
+		PlaybackCapture& cached = this->cache.back();
+		cached.capture = capture.capture;
+		cached.timestamp = capture.timestamp;
+		cached.bodySkeletons = capture.bodySkeletons;
+		cached.bHasSkeletons = capture.bHasSkeletons;
+		cached.numBytes = capture.numBytes;
+		if (bKeepColor)
+		{
+			cached.colorPix = capture.colorPix;
+			cached.bColorDecoded = true;
+		}
+
+		this->cacheBytes += numBytes;
+	}
+
+	void PlaybackReader::clearCache()
+	{
+		this->cache.clear();
+		this->cacheBytes = 0;
+		this->cachePosition = 0;
+		this->bCaching = false;
+		this->bCacheFailed = false;
+		this->bCacheComplete = false;
+	}
+
+	bool PlaybackReader::isFull() const
+	{
+		if (this->captures.size() >= this->settings.maxCaptures) return true;
+
+		// Always let one capture through, however big.
+		return this->settings.maxMegabytes > 0 && !this->captures.empty() && this->numQueuedBytes >= this->settings.maxMegabytes * 1024 * 1024;
+	}
+
+	void PlaybackReader::push(PlaybackCapture& capture, uint64_t generation)
+	{
+		if (generation != this->generation)
+		{
+			// Read before a seek, throw it away.
+			this->recycle(capture);
+			return;
+		}
+
+		if (capture.bColorDecoded)
+		{
+			capture.numBytes += capture.colorPix.getTotalBytes();
+		}
+
+		capture.generation = generation;
+		this->numQueuedBytes += capture.numBytes;
+		this->captures.push_back(std::move(capture));
+		this->readyCondition.notify_all();
+	}
+
+	void PlaybackReader::recycle(PlaybackCapture& capture)
+	{
+		if (capture.colorPix.isAllocated())
+		{
+			this->freePixels.emplace_back();
+			this->freePixels.back().swap(capture.colorPix);
+		}
+		capture.clear();
+	}
+
+	void PlaybackReader::popPending()
+	{
+		PendingCapture& pending = this->pendingCaptures.front();
+		if (pending.decodeTicket != 0)
+		{
+			pending.capture.bColorDecoded = this->jpegDecoder.wait(pending.decodeTicket, pending.capture.colorPix);
+		}
+
+		this->cacheCapture(pending.capture);
+
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+			this->push(pending.capture, pending.generation);
+		}
+
+		this->pendingCaptures.pop_front();
+	}
+
+	void PlaybackReader::clearPending()
+	{
+		for (auto& pending : this->pendingCaptures)
+		{
+			if (pending.decodeTicket != 0)
+			{
+				this->jpegDecoder.wait(pending.decodeTicket, pending.capture.colorPix);
+			}
+		}
+
+		std::unique_lock<std::mutex> lock(this->mutex);
+		for (auto& pending : this->pendingCaptures)
+		{
+			this->recycle(pending.capture);
+		}
+		this->pendingCaptures.clear();
+	}
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <k4arecord/playback.hpp>
+#include <turbojpeg.h>
+
+#include "ofPixels.h"
+
+#include "BodySkeleton.h"
+#include "JpegDecoder.h"
+
+namespace ofxAzureKinect
+{
+	// A capture read from a recording, with its color already decoded and its recorded skeletons.
+	struct PlaybackCapture
+	{
+		k4a::capture capture;
+		std::chrono::microseconds timestamp;
+
+		// Only set for MJPEG color when decoding ahead.
+		ofPixels colorPix;
+		bool bColorDecoded;
+
+		// Latest skeleton block at or before the capture, if any.
+		std::vector<BodySkeleton> bodySkeletons;
+		bool bHasSkeletons;
+
+		// Counts the times the reader wrapped around to the start, and seeks.
+		uint64_t loop;
+		// Seek generation the capture was read in, see PlaybackReader::getGeneration().
+		uint64_t generation;
+
+		size_t numBytes;
+
+		PlaybackCapture();
+
+		void clear();
+	};
+
+	enum PlaybackCacheMode
+	{
+		// Read every capture from disk.
+		PLAYBACK_CACHE_NONE,
+		// Keep the captures as recorded, MJPEG color is decoded again on every loop.
+		PLAYBACK_CACHE_COMPRESSED,
+		// Also keep the decoded color, so later loops neither read nor decode.
+		PLAYBACK_CACHE_DECODED
+	};
+
+	struct PlaybackReaderSettings
+	{
+		// Ready captures kept ahead of playback, by count and by memory (0 for no memory limit).
+		size_t maxCaptures;
+		size_t maxMegabytes;
+
+		bool decodeColor;
+		size_t jpegDecodeThreads;
+		int jpegDecodeDownscale;
+
+		bool readSkeletons;
+		bool autoloop;
+
+		// Keep the whole recording in memory after the first pass from the start, up to a limit (0 for none).
+		PlaybackCacheMode cacheMode;
+		size_t cacheMaxMegabytes;
+
+		PlaybackReaderSettings();
+	};
+
+	// Reads captures from a recording on its own thread, decodes MJPEG color and
+	// picks up recorded skeletons, and keeps a bounded queue of ready captures.
+	// The reader opens its own handle on the file, so the owner can keep using its
+	// handle for tags and calibration. Seeks are handed to the reader thread.
+	// Short clips can be cached in memory, in which case loops and seeks are served
+	// from the cache once a full pass has been read.
+	class PlaybackReader
+	{
+	public:
+		PlaybackReader();
+		~PlaybackReader();
+
+		bool open(const std::string& filepath);
+		bool close();
+
+		bool isOpen() const;
+
+		bool start(const PlaybackReaderSettings& settings = PlaybackReaderSettings());
+		bool stop();
+
+		bool isRunning() const;
+
+		// Takes the next ready capture, waiting up to the timeout for one. Returns false if there is none yet.
+		// The previous contents of the capture are recycled.
+		bool pop(PlaybackCapture& capture, std::chrono::microseconds timeout = std::chrono::microseconds(0));
+
+		// Drops the queue and reads from the timestamp on, also applies if the reader is not running.
+		void seek(std::chrono::microseconds timestamp, k4a_playback_seek_origin_t origin = K4A_PLAYBACK_SEEK_BEGIN);
+
+		// Drops the queue and reads nothing more until the next seek or start, as if past the end of the recording.
+		void finish();
+
+		// The end of the recording was reached without looping and everything was popped.
+		bool isFinished() const;
+
+		// Bumped by every seek, captures popped from an older generation are stale.
+		uint64_t getGeneration() const;
+
+		size_t getNumQueuedCaptures() const;
+		size_t getNumQueuedBytes() const;
+
+		// The whole recording is in memory.
+		bool isCached() const;
+
+	private:
+		struct PendingCapture
+		{
+			PlaybackCapture capture;
+			uint64_t decodeTicket;
+			uint64_t generation;
+		};
+
+		void readerFunction();
+
+		void seekTo(std::chrono::microseconds timestamp, k4a_playback_seek_origin_t origin);
+
+		bool readNext(PlaybackCapture& capture);
+		void readSkeletons(PlaybackCapture& capture);
+
+		void cacheCapture(const PlaybackCapture& capture);
+		void clearCache();
+
+		bool isFull() const;
+		void push(PlaybackCapture& capture, uint64_t generation);
+		void recycle(PlaybackCapture& capture);
+
+		void popPending();
+		void clearPending();
+
+	private:
+		bool bOpen;
+		bool bRunning;
+
+		k4a::playback playback;
+		k4a_record_configuration_t config;
+		std::chrono::microseconds recordingLength;
+		bool bHasSkeletonTrack;
+
+		PlaybackReaderSettings settings;
+		bool bDecodeColor;
+		bool bReadSkeletons;
+
+		std::thread thread;
+
+		mutable std::mutex mutex;
+		std::condition_variable condition;
+		std::condition_variable readyCondition;
+
+		std::deque<PlaybackCapture> captures;
+		size_t numQueuedBytes;
+		std::vector<ofPixels> freePixels;
+
+		// Seeks bump the generation, so captures read before the seek are thrown away.
+		bool bSeekRequested;
+		std::chrono::microseconds seekTimestamp;
+		k4a_playback_seek_origin_t seekOrigin;
+		uint64_t generation;
+		uint64_t loop;
+		bool bEndOfFile;
+
+		// Reader thread only.
+		tjhandle jpegDecompressor;
+		JpegDecoder jpegDecoder;
+		std::deque<PendingCapture> pendingCaptures;
+		k4a::data_block skeletonBlock;
+
+		// Captures from the start of the recording, complete once the end was reached.
+		std::vector<PlaybackCapture> cache;
+		size_t cacheBytes;
+		size_t cachePosition;
+		bool bAtStart;
+		bool bCaching;
+		bool bCacheFailed;
+		std::atomic<bool> bCacheComplete;
+	};
+}
@@ -0,0 +1,522 @@
+#include "PointCloudBuilder.h"
+
+#include <algorithm>
+
+#include <k4abt.h>
+
+#include "ofLog.h"
+
+#include "HalfFloat.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define OFX_K4A_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define OFX_K4A_TARGET_SSE41
+#define OFX_K4A_TARGET_AVX2
+#else
+#define OFX_K4A_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define OFX_K4A_TARGET_AVX2 __attribute__((target("avx2,f16c")))
+#endif
+#endif
+
+namespace
+{
+	inline int countTrailingZeros(uint32_t mask)
+	{
+#ifdef _MSC_VER
+		unsigned long idx;
+		_BitScanForward(&idx, mask);
+		return static_cast<int>(idx);
+#else
+		return __builtin_ctz(mask);
+#endif
+	}
+
+	// Writes out the pixels set in the mask, in order, from the premultiplied x/y pairs and depths.
+	inline size_t compactPixels(uint32_t mask, const float* xy, const float* depths, int x, int y,
+		glm::vec3* positions, glm::vec2* uvs)
+	{
+		size_t count = 0;
+		while (mask)
+		{
+			const int i = countTrailingZeros(mask);
+			positions[count] = glm::vec3(xy[i * 2], xy[i * 2 + 1], depths[i]);
+			uvs[count] = glm::vec2(x + i, y);
+			++count;
+			mask &= mask - 1;
+		}
+		return count;
+	}
+
+	// Collapses a movemask over interleaved x/y pairs into one bit per pixel that is set when both are set.
+	inline uint32_t pairMask(uint32_t mask)
+	{
+		const uint32_t pairs = mask & (mask >> 1);
+		return (pairs & 0x1) | ((pairs >> 1) & 0x2) | ((pairs >> 2) & 0x4) | ((pairs >> 3) & 0x8);
+	}
+
+	inline k4a_float2_t loadTableValue(const k4a_float2_t* tableData, int x)
+	{
+		return tableData[x];
+	}
+
+	inline k4a_float2_t loadTableValue(const uint16_t* tableData, int x)
+	{
+		k4a_float2_t val;
+		val.xy.x = ofxAzureKinect::halfToFloat(tableData[x * 2]);
+		val.xy.y = ofxAzureKinect::halfToFloat(tableData[x * 2 + 1]);
+		return val;
+	}
+
+	template<typename TableType>
+	size_t buildRowScalar(const uint16_t* depthData, const TableType* tableData, int x, int width, int y,
+		glm::vec3* positions, glm::vec2* uvs)
+	{
+		size_t count = 0;
+		for (; x < width; ++x)
+		{
+			const k4a_float2_t tableVal = loadTableValue(tableData, x);
+			if (depthData[x] != 0 &&
+				tableVal.xy.x != 0 && tableVal.xy.y != 0)
+			{
+				float depthVal = static_cast<float>(depthData[x]);
+				positions[count] = glm::vec3(
+					tableVal.xy.x * depthVal,
+					tableVal.xy.y * depthVal,
+					depthVal
+				);
+
+				uvs[count] = glm::vec2(x, y);
+
+				++count;
+			}
+		}
+		return count;
+	}
+
+	inline const k4a_float2_t* getTableRow(const k4a_float2_t* tableData, int width, int y)
+	{
+		return tableData + y * width;
+	}
+
+	inline const uint16_t* getTableRow(const uint16_t* tableData, int width, int y)
+	{
+		return tableData + y * width * 2;
+	}
+
+#ifdef OFX_K4A_X86
+	OFX_K4A_TARGET_SSE41
+	size_t buildRowSse41(const uint16_t* depthData, const k4a_float2_t* tableData, int width, int y,
+		glm::vec3* positions, glm::vec2* uvs)
+	{
+		alignas(16) float xy[8];
+		alignas(16) float depths[4];
+
+		const __m128 zero = _mm_setzero_ps();
+
+		size_t count = 0;
+		int x = 0;
+		for (; x + 4 <= width; x += 4)
+		{
+			const __m128i depthInts = _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(depthData + x)));
+			const __m128 depthVals = _mm_cvtepi32_ps(depthInts);
+
+			const __m128 table01 = _mm_loadu_ps(&tableData[x].v[0]);
+			const __m128 table23 = _mm_loadu_ps(&tableData[x + 2].v[0]);
+
+			// Unordered compare so that NaNs count as non-zero, like the scalar version.
+			uint32_t mask = static_cast<uint32_t>(_mm_movemask_ps(_mm_cmpneq_ps(depthVals, zero)));
+			mask &= pairMask(_mm_movemask_ps(_mm_cmpneq_ps(table01, zero))) |
+				(pairMask(_mm_movemask_ps(_mm_cmpneq_ps(table23, zero))) << 2);
+			if (mask == 0) continue;
+
+			_mm_store_ps(xy, _mm_mul_ps(table01, _mm_unpacklo_ps(depthVals, depthVals)));
+			_mm_store_ps(xy + 4, _mm_mul_ps(table23, _mm_unpackhi_ps(depthVals, depthVals)));
+			_mm_store_ps(depths, depthVals);
+
+			count += compactPixels(mask, xy, depths, x, y, positions + count, uvs + count);
+		}
+
+		return count + buildRowScalar(depthData, tableData, x, width, y, positions + count, uvs + count);
+	}
+
+	OFX_K4A_TARGET_AVX2
+	inline void loadTableAvx2(const k4a_float2_t* tableData, int x, __m256& table0123, __m256& table4567)
+	{
+		table0123 = _mm256_loadu_ps(&tableData[x].v[0]);
+		table4567 = _mm256_loadu_ps(&tableData[x + 4].v[0]);
+	}
+
+	OFX_K4A_TARGET_AVX2
+	inline void loadTableAvx2(const uint16_t* tableData, int x, __m256& table0123, __m256& table4567)
+	{
+		table0123 = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(tableData + x * 2)));
+		table4567 = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(tableData + x * 2 + 8)));
+	}
+
+	template<typename TableType>
+	OFX_K4A_TARGET_AVX2
+	size_t buildRowAvx2(const uint16_t* depthData, const TableType* tableData, int width, int y,
+		glm::vec3* positions, glm::vec2* uvs)
+	{
+		alignas(32) float xy[16];
+		alignas(32) float depths[8];
+
+		const __m256 zero = _mm256_setzero_ps();
+
+		size_t count = 0;
+		int x = 0;
+		for (; x + 8 <= width; x += 8)
+		{
+			const __m256i depthInts = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(depthData + x)));
+			const __m256 depthVals = _mm256_cvtepi32_ps(depthInts);
+
+			__m256 table0123, table4567;
+			loadTableAvx2(tableData, x, table0123, table4567);
+
+			// Unordered compare so that NaNs count as non-zero, like the scalar version.
+			uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(depthVals, zero, _CMP_NEQ_UQ)));
+			const uint32_t tableMask0 = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(table0123, zero, _CMP_NEQ_UQ)));
+			const uint32_t tableMask1 = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(table4567, zero, _CMP_NEQ_UQ)));
+			mask &= pairMask(tableMask0) | (pairMask(tableMask0 >> 4) << 2) |
+				(pairMask(tableMask1) << 4) | (pairMask(tableMask1 >> 4) << 6);
+			if (mask == 0) continue;
+
+			// Duplicate each depth to line up with its x/y pair.
+			const __m256 depthLo = _mm256_unpacklo_ps(depthVals, depthVals);
+			const __m256 depthHi = _mm256_unpackhi_ps(depthVals, depthVals);
+			_mm256_store_ps(xy, _mm256_mul_ps(table0123, _mm256_permute2f128_ps(depthLo, depthHi, 0x20)));
+			_mm256_store_ps(xy + 8, _mm256_mul_ps(table4567, _mm256_permute2f128_ps(depthLo, depthHi, 0x31)));
+			_mm256_store_ps(depths, depthVals);
+
+			count += compactPixels(mask, xy, depths, x, y, positions + count, uvs + count);
+		}
+
+		return count + buildRowScalar(depthData, tableData, x, width, y, positions + count, uvs + count);
+	}
+#endif
+}
+
+namespace ofxAzureKinect
+{
+	PointCloudBuilder::Kernel PointCloudBuilder::getBestSupportedKernel()
+	{
+		if (isKernelSupported(KERNEL_AVX2)) return KERNEL_AVX2;
+		if (isKernelSupported(KERNEL_SSE41)) return KERNEL_SSE41;
+		return KERNEL_SCALAR;
+	}
+
+	bool PointCloudBuilder::isKernelSupported(Kernel kernel)
+	{
+		if (kernel == KERNEL_SCALAR) return true;
+
+#ifdef OFX_K4A_X86
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 0);
+		const int maxLeaf = info[0];
+
+		__cpuid(info, 1);
+		const bool sse41 = (info[2] & (1 << 19)) != 0;
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		const bool f16c = (info[2] & (1 << 29)) != 0;
+		if (kernel == KERNEL_SSE41) return sse41;
+
+		if (!osxsave || !f16c || maxLeaf < 7) return false;
+		// Make sure the OS saves the YMM registers.
+		if ((_xgetbv(0) & 0x6) != 0x6) return false;
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		__builtin_cpu_init();
+		if (kernel == KERNEL_SSE41) return __builtin_cpu_supports("sse4.1");
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c");
+#endif
+#else
+		return false;
+#endif
+	}
+
+	size_t PointCloudBuilder::buildRows(Kernel kernel,
+		const uint16_t* depthData, const k4a_float2_t* tableData, int width, int rowBegin, int rowEnd,
+		glm::vec3* positions, glm::vec2* uvs)
+	{
+		size_t count = 0;
+		for (int y = rowBegin; y < rowEnd; ++y)
+		{
+			const uint16_t* depthRow = depthData + y * width;
+			const k4a_float2_t* tableRow = tableData + y * width;
+
+			switch (kernel)
+			{
+#ifdef OFX_K4A_X86
+			case KERNEL_AVX2:
+				count += buildRowAvx2(depthRow, tableRow, width, y, positions + count, uvs + count);
+				break;
+
+			case KERNEL_SSE41:
+				count += buildRowSse41(depthRow, tableRow, width, y, positions + count, uvs + count);
+				break;
+#endif
+
+			case KERNEL_SCALAR:
+			default:
+				count += buildRowScalar(depthRow, tableRow, 0, width, y, positions + count, uvs + count);
+				break;
+			}
+		}
+		return count;
+	}
+
+	size_t PointCloudBuilder::buildRows(Kernel kernel,
+		const uint16_t* depthData, const uint16_t* halfTableData, int width, int rowBegin, int rowEnd,
+		glm::vec3* positions, glm::vec2* uvs)
+	{
+		size_t count = 0;
+		for (int y = rowBegin; y < rowEnd; ++y)
+		{
+			const uint16_t* depthRow = depthData + y * width;
+			const uint16_t* tableRow = halfTableData + y * width * 2;
+
+#ifdef OFX_K4A_X86
+			// Half tables need F16C, which comes with AVX2, so SSE4.1 uses the scalar path.
+			if (kernel == KERNEL_AVX2)
+			{
+				count += buildRowAvx2(depthRow, tableRow, width, y, positions + count, uvs + count);
+				continue;
+			}
+#endif
+
+			count += buildRowScalar(depthRow, tableRow, 0, width, y, positions + count, uvs + count);
+		}
+		return count;
+	}
+
+	PointCloudBuilder::PointCloudBuilder()
+		: kernel(getBestSupportedKernel())
+	{}
+
+	PointCloudBuilder::~PointCloudBuilder()
+	{
+		this->close();
+	}
+
+	bool PointCloudBuilder::setup(size_t numThreads)
+	{
+		this->close();
+
+		if (!this->workerPool.setup(std::max(numThreads, size_t(1))))
+		{
+			return false;
+		}
+
+		this->bands.resize(this->workerPool.getNumThreads());
+		return true;
+	}
+
+	bool PointCloudBuilder::close()
+	{
+		this->bands.clear();
+		return this->workerPool.close();
+	}
+
+	size_t PointCloudBuilder::getNumThreads() const
+	{
+		return this->workerPool.isRunning() ? this->workerPool.getNumThreads() : 1;
+	}
+
+	bool PointCloudBuilder::build(const k4a::image& depthImg, const k4a::image& tableImg,
+		std::vector<glm::vec3>& positions, std::vector<glm::vec2>& uvs, size_t& numPoints)
+	{
+		const auto frameDims = glm::ivec2(depthImg.get_width_pixels(), depthImg.get_height_pixels());
+		const auto tableDims = glm::ivec2(tableImg.get_width_pixels(), tableImg.get_height_pixels());
+		if (frameDims != tableDims)
+		{
+			ofLogError(__FUNCTION__) << "Image dims mismatch! " << frameDims << " vs " << tableDims;
+			return false;
+		}
+
+		const auto depthData = reinterpret_cast<const uint16_t*>(depthImg.get_buffer());
+
+		// Half tables pack each x/y pair in 4 bytes instead of 8.
+		const bool bHalfTable = tableImg.get_stride_bytes() == frameDims.x * static_cast<int>(2 * sizeof(uint16_t));
+		const auto tableData = reinterpret_cast<const k4a_float2_t*>(tableImg.get_buffer());
+		const auto halfTableData = reinterpret_cast<const uint16_t*>(tableImg.get_buffer());
+		const auto buildBand = [&](int rowBegin, int rowEnd, glm::vec3* bandPositions, glm::vec2* bandUvs)
+		{
+			return bHalfTable ?
+				buildRows(this->kernel, depthData, halfTableData, frameDims.x, rowBegin, rowEnd, bandPositions, bandUvs) :
+				buildRows(this->kernel, depthData, tableData, frameDims.x, rowBegin, rowEnd, bandPositions, bandUvs);
+		};
+
+		positions.resize(frameDims.x * frameDims.y);
+		uvs.resize(frameDims.x * frameDims.y);
+
+		const size_t numBands = std::min(this->bands.size(), static_cast<size_t>(frameDims.y));
+		if (numBands < 2)
+		{
+			numPoints = buildBand(0, frameDims.y, positions.data(), uvs.data());
+			return true;
+		}
+
+		// Compact each band on its own, the first one straight into the output and the rest into scratch.
+		for (size_t i = 0; i < numBands; ++i)
+		{
+			this->bands[i].rowBegin = static_cast<int>(frameDims.y * i / numBands);
+			this->bands[i].rowEnd = static_cast<int>(frameDims.y * (i + 1) / numBands);
+		}
+
+		this->workerPool.run(numBands, [&](size_t i)
+		{
+			Band& band = this->bands[i];
+			glm::vec3* bandPositions = positions.data();
+			glm::vec2* bandUvs = uvs.data();
+			if (i > 0)
+			{
+				const size_t bandSize = (band.rowEnd - band.rowBegin) * frameDims.x;
+				band.positions.resize(bandSize);
+				band.uvs.resize(bandSize);
+				bandPositions = band.positions.data();
+				bandUvs = band.uvs.data();
+			}
+
+			band.numPoints = buildBand(band.rowBegin, band.rowEnd, bandPositions, bandUvs);
+		});
+
+		// Prefix sum the band sizes, then copy each band to its place.
+		size_t offset = 0;
+		for (size_t i = 0; i < numBands; ++i)
+		{
+			this->bands[i].offset = offset;
+			offset += this->bands[i].numPoints;
+		}
+		numPoints = offset;
+
+		this->workerPool.run(numBands - 1, [&](size_t i)
+		{
+			const Band& band = this->bands[i + 1];
+			std::copy(band.positions.begin(), band.positions.begin() + band.numPoints, positions.begin() + band.offset);
+			std::copy(band.uvs.begin(), band.uvs.begin() + band.numPoints, uvs.begin() + band.offset);
+		});
+
+		return true;
+	}
+
+	bool PointCloudBuilder::buildBodies(const k4a::image& depthImg, const k4a::image& tableImg, const k4a::image& bodyIndexImg, bool bBackground,
+		std::vector<glm::vec3>& positions, std::vector<glm::vec2>& uvs, std::vector<size_t>& bucketOffsets)
+	{
+		const auto frameDims = glm::ivec2(depthImg.get_width_pixels(), depthImg.get_height_pixels());
+		const auto tableDims = glm::ivec2(tableImg.get_width_pixels(), tableImg.get_height_pixels());
+		const auto bodyIndexDims = glm::ivec2(bodyIndexImg.get_width_pixels(), bodyIndexImg.get_height_pixels());
+		if (frameDims != tableDims || frameDims != bodyIndexDims)
+		{
+			ofLogError(__FUNCTION__) << "Image dims mismatch! " << frameDims << " vs " << tableDims << " vs " << bodyIndexDims;
+			return false;
+		}
+
+		const auto depthData = reinterpret_cast<const uint16_t*>(depthImg.get_buffer());
+		const auto bodyIndexData = reinterpret_cast<const uint8_t*>(bodyIndexImg.get_buffer());
+		const int bodyIndexStride = bodyIndexImg.get_stride_bytes();
+
+		const bool bHalfTable = tableImg.get_stride_bytes() == frameDims.x * static_cast<int>(2 * sizeof(uint16_t));
+		const auto tableData = reinterpret_cast<const k4a_float2_t*>(tableImg.get_buffer());
+		const auto halfTableData = reinterpret_cast<const uint16_t*>(tableImg.get_buffer());
+		const auto buildBand = [&](Band& band)
+		{
+			return bHalfTable ?
+				buildRows(this->kernel, depthData, halfTableData, frameDims.x, band.rowBegin, band.rowEnd, band.positions.data(), band.uvs.data()) :
+				buildRows(this->kernel, depthData, tableData, frameDims.x, band.rowBegin, band.rowEnd, band.positions.data(), band.uvs.data());
+		};
+
+		const size_t numBands = std::max(std::min(this->bands.size(), static_cast<size_t>(frameDims.y)), size_t(1));
+		if (this->bands.size() < numBands)
+		{
+			this->bands.resize(numBands);
+		}
+		for (size_t i = 0; i < numBands; ++i)
+		{
+			this->bands[i].rowBegin = static_cast<int>(frameDims.y * i / numBands);
+			this->bands[i].rowEnd = static_cast<int>(frameDims.y * (i + 1) / numBands);
+		}
+
+		// Compact each band into scratch with the same kernel as build(), then look up the body
+		// index of each point from its uv and count the points per bucket.
+		this->workerPool.run(numBands, [&](size_t i)
+		{
+			Band& band = this->bands[i];
+			const size_t bandSize = (band.rowEnd - band.rowBegin) * frameDims.x;
+			band.positions.resize(bandSize);
+			band.uvs.resize(bandSize);
+			band.bodyIndices.resize(bandSize);
+
+			band.numPoints = buildBand(band);
+
+			band.bucketCounts.fill(0);
+			for (size_t j = 0; j < band.numPoints; ++j)
+			{
+				const glm::vec2& uv = band.uvs[j];
+				const uint8_t bodyIndex = bodyIndexData[static_cast<int>(uv.y) * bodyIndexStride + static_cast<int>(uv.x)];
+				band.bodyIndices[j] = bodyIndex;
+				++band.bucketCounts[bodyIndex];
+			}
+			if (!bBackground)
+			{
+				band.bucketCounts[K4ABT_BODY_INDEX_MAP_BACKGROUND] = 0;
+			}
+		});
+
+		// Prefix sum the counts, laying the buckets out one after the other with each band's share
+		// in row order, and turn the band counts into write cursors.
+		bucketOffsets.resize(NUM_BODY_BUCKETS + 1);
+		size_t offset = 0;
+		for (size_t b = 0; b < NUM_BODY_BUCKETS; ++b)
+		{
+			bucketOffsets[b] = offset;
+			for (size_t i = 0; i < numBands; ++i)
+			{
+				const size_t count = this->bands[i].bucketCounts[b];
+				this->bands[i].bucketCounts[b] = offset;
+				offset += count;
+			}
+		}
+		bucketOffsets[NUM_BODY_BUCKETS] = offset;
+
+		positions.resize(frameDims.x * frameDims.y);
+		uvs.resize(frameDims.x * frameDims.y);
+
+		// Scatter each band's points to their buckets.
+		this->workerPool.run(numBands, [&](size_t i)
+		{
+			Band& band = this->bands[i];
+			size_t* cursors = band.bucketCounts.data();
+			for (size_t j = 0; j < band.numPoints; ++j)
+			{
+				const uint8_t bodyIndex = band.bodyIndices[j];
+				if (!bBackground && bodyIndex == K4ABT_BODY_INDEX_MAP_BACKGROUND) continue;
+
+				const size_t idx = cursors[bodyIndex]++;
+				positions[idx] = band.positions[j];
+				uvs[idx] = band.uvs[j];
+			}
+		});
+
+		return true;
+	}
+
+	void PointCloudBuilder::setKernel(Kernel kernel)
+	{
+		if (!isKernelSupported(kernel))
+		{
+			ofLogWarning(__FUNCTION__) << "Kernel " << kernel << " not supported on this CPU, ignoring.";
+			return;
+		}
+		this->kernel = kernel;
+	}
+
+	PointCloudBuilder::Kernel PointCloudBuilder::getKernel() const
+	{
+		return this->kernel;
+	}
+}
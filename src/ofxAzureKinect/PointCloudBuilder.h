@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include <k4a/k4a.hpp>
+
+#include "ofVectorMath.h"
+
+#include "WorkerPool.h"
+
+namespace ofxAzureKinect
+{
+	// Builds compacted point clouds from a depth image and a world LUT.
+	// The inner loop has SSE4.1 and AVX2 versions picked at runtime, all of which
+	// produce the same output as the scalar version.
+	// With more than one thread, row bands are compacted in parallel then stitched
+	// back together, so the point order is the same as a single threaded build.
+	// Tables can be either float or half float x/y pairs.
+	// Points can also be split by a body index map, in which case they are grouped
+	// into one contiguous range per body index value, background last.
+	class PointCloudBuilder
+	{
+	public:
+		// One bucket per body index map value, the last one is K4ABT_BODY_INDEX_MAP_BACKGROUND.
+		static const size_t NUM_BODY_BUCKETS = 256;
+
+		enum Kernel
+		{
+			KERNEL_SCALAR,
+			KERNEL_SSE41,
+			KERNEL_AVX2
+		};
+
+		static Kernel getBestSupportedKernel();
+		static bool isKernelSupported(Kernel kernel);
+
+		static size_t buildRows(Kernel kernel,
+			const uint16_t* depthData, const k4a_float2_t* tableData, int width, int rowBegin, int rowEnd,
+			glm::vec3* positions, glm::vec2* uvs);
+		static size_t buildRows(Kernel kernel,
+			const uint16_t* depthData, const uint16_t* halfTableData, int width, int rowBegin, int rowEnd,
+			glm::vec3* positions, glm::vec2* uvs);
+
+	public:
+		PointCloudBuilder();
+		~PointCloudBuilder();
+
+		bool setup(size_t numThreads);
+		bool close();
+
+		size_t getNumThreads() const;
+
+		bool build(const k4a::image& depthImg, const k4a::image& tableImg,
+			std::vector<glm::vec3>& positions, std::vector<glm::vec2>& uvs, size_t& numPoints);
+
+		// Builds the points bucketed by body index, compacting each band with the build() kernel then scattering it to the buckets.
+		// Bucket i ends up in [bucketOffsets[i], bucketOffsets[i + 1]), and the total is bucketOffsets.back().
+		// Background points are skipped entirely unless requested.
+		bool buildBodies(const k4a::image& depthImg, const k4a::image& tableImg, const k4a::image& bodyIndexImg, bool bBackground,
+			std::vector<glm::vec3>& positions, std::vector<glm::vec2>& uvs, std::vector<size_t>& bucketOffsets);
+
+		void setKernel(Kernel kernel);
+		Kernel getKernel() const;
+
+	private:
+		struct Band
+		{
+			int rowBegin;
+			int rowEnd;
+			size_t numPoints;
+			size_t offset;
+			std::vector<glm::vec3> positions;
+			std::vector<glm::vec2> uvs;
+			std::vector<uint8_t> bodyIndices;
+			std::array<size_t, NUM_BODY_BUCKETS> bucketCounts;
+		};
+
+		Kernel kernel;
+
+		WorkerPool workerPool;
+		std::vector<Band> bands;
+	};
+}
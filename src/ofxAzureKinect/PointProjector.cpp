@@ -0,0 +1,258 @@
+#include "PointProjector.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "ofLog.h"
+
+#include "PointCloudBuilder.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define OFX_K4A_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define OFX_K4A_TARGET_AVX2
+#else
+#define OFX_K4A_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace
+{
+#ifdef OFX_K4A_X86
+	// Same steps and operation order as CameraModel::project(), so both paths give the same results.
+	OFX_K4A_TARGET_AVX2
+	size_t projectAvx2(const float* rotation, const float* translation, bool bIdentity, const k4a_calibration_camera_t& camera,
+		const glm::vec3* points, size_t numPoints, glm::vec2* projPoints, uint8_t* valid)
+	{
+		const auto& params = camera.intrinsics.parameters.param;
+		const bool bRational6kt = (camera.intrinsics.type == K4A_CALIBRATION_LENS_DISTORTION_MODEL_RATIONAL_6KT);
+
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 one = _mm256_set1_ps(1.f);
+		const __m256 two = _mm256_set1_ps(2.f);
+		const __m256 maxRadius = _mm256_set1_ps(camera.metric_radius * camera.metric_radius);
+		const __m256 tangentialScale = _mm256_set1_ps(bRational6kt ? 1.f : 2.f);
+
+		const __m256 codx = _mm256_set1_ps(params.codx);
+		const __m256 cody = _mm256_set1_ps(params.cody);
+		const __m256 fx = _mm256_set1_ps(params.fx);
+		const __m256 fy = _mm256_set1_ps(params.fy);
+		const __m256 cx = _mm256_set1_ps(params.cx);
+		const __m256 cy = _mm256_set1_ps(params.cy);
+		const __m256 k1 = _mm256_set1_ps(params.k1);
+		const __m256 k2 = _mm256_set1_ps(params.k2);
+		const __m256 k3 = _mm256_set1_ps(params.k3);
+		const __m256 k4 = _mm256_set1_ps(params.k4);
+		const __m256 k5 = _mm256_set1_ps(params.k5);
+		const __m256 k6 = _mm256_set1_ps(params.k6);
+		const __m256 p1 = _mm256_set1_ps(params.p1);
+		const __m256 p2 = _mm256_set1_ps(params.p2);
+
+		__m256 r[9];
+		__m256 t[3];
+		for (int i = 0; i < 9; ++i) r[i] = _mm256_set1_ps(rotation[i]);
+		for (int i = 0; i < 3; ++i) t[i] = _mm256_set1_ps(translation[i]);
+
+		// glm::vec3 is packed, so component c of point i is at float offset i * 3 + c.
+		const __m256i gatherIdx = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+
+		size_t numValid = 0;
+		size_t i = 0;
+		for (; i + 8 <= numPoints; i += 8)
+		{
+			const float* base = &points[i].x;
+			__m256 px = _mm256_i32gather_ps(base, gatherIdx, 4);
+			__m256 py = _mm256_i32gather_ps(base + 1, gatherIdx, 4);
+			__m256 pz = _mm256_i32gather_ps(base + 2, gatherIdx, 4);
+
+			if (!bIdentity)
+			{
+				const __m256 sx = px;
+				const __m256 sy = py;
+				const __m256 sz = pz;
+				px = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r[0], sx), _mm256_mul_ps(r[1], sy)), _mm256_mul_ps(r[2], sz)), t[0]);
+				py = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r[3], sx), _mm256_mul_ps(r[4], sy)), _mm256_mul_ps(r[5], sz)), t[1]);
+				pz = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r[6], sx), _mm256_mul_ps(r[7], sy)), _mm256_mul_ps(r[8], sz)), t[2]);
+			}
+
+			__m256 mask = _mm256_cmp_ps(pz, zero, _CMP_GT_OQ);
+
+			const __m256 xp = _mm256_sub_ps(_mm256_div_ps(px, pz), codx);
+			const __m256 yp = _mm256_sub_ps(_mm256_div_ps(py, pz), cody);
+
+			const __m256 xp2 = _mm256_mul_ps(xp, xp);
+			const __m256 yp2 = _mm256_mul_ps(yp, yp);
+			const __m256 xyp = _mm256_mul_ps(xp, yp);
+			const __m256 rs = _mm256_add_ps(xp2, yp2);
+			mask = _mm256_and_ps(mask, _mm256_cmp_ps(rs, maxRadius, _CMP_NGT_UQ));
+
+			const __m256 rss = _mm256_mul_ps(rs, rs);
+			const __m256 rsc = _mm256_mul_ps(rss, rs);
+			const __m256 a = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(one, _mm256_mul_ps(k1, rs)), _mm256_mul_ps(k2, rss)), _mm256_mul_ps(k3, rsc));
+			const __m256 b = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(one, _mm256_mul_ps(k4, rs)), _mm256_mul_ps(k5, rss)), _mm256_mul_ps(k6, rsc));
+			const __m256 bi = _mm256_blendv_ps(one, _mm256_div_ps(one, b), _mm256_cmp_ps(b, zero, _CMP_NEQ_UQ));
+			const __m256 d = _mm256_mul_ps(a, bi);
+
+			const __m256 rs2xp2 = _mm256_add_ps(rs, _mm256_mul_ps(two, xp2));
+			const __m256 rs2yp2 = _mm256_add_ps(rs, _mm256_mul_ps(two, yp2));
+			const __m256 txyp = _mm256_mul_ps(tangentialScale, xyp);
+
+			const __m256 xpd = _mm256_add_ps(_mm256_mul_ps(xp, d), _mm256_add_ps(_mm256_mul_ps(rs2xp2, p2), _mm256_mul_ps(txyp, p1)));
+			const __m256 ypd = _mm256_add_ps(_mm256_mul_ps(yp, d), _mm256_add_ps(_mm256_mul_ps(rs2yp2, p1), _mm256_mul_ps(txyp, p2)));
+
+			const __m256 u = _mm256_and_ps(mask, _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(xpd, codx), fx), cx));
+			const __m256 v = _mm256_and_ps(mask, _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(ypd, cody), fy), cy));
+
+			// Interleave back into u/v pairs.
+			const __m256 uvLo = _mm256_unpacklo_ps(u, v);
+			const __m256 uvHi = _mm256_unpackhi_ps(u, v);
+			_mm256_storeu_ps(&projPoints[i].x, _mm256_permute2f128_ps(uvLo, uvHi, 0x20));
+			_mm256_storeu_ps(&projPoints[i + 4].x, _mm256_permute2f128_ps(uvLo, uvHi, 0x31));
+
+			const int validMask = _mm256_movemask_ps(mask);
+			for (int j = 0; j < 8; ++j)
+			{
+				const uint8_t bValid = (validMask >> j) & 1;
+				if (valid) valid[i + j] = bValid;
+				numValid += bValid;
+			}
+		}
+
+		return numValid;
+	}
+#endif
+}
+
+namespace ofxAzureKinect
+{
+	PointProjector::PointProjector()
+		: bSetup(false)
+		, bIdentity(true)
+		, bUseSimd(PointCloudBuilder::isKernelSupported(PointCloudBuilder::KERNEL_AVX2))
+		, camera()
+	{
+		this->clear();
+	}
+
+	bool PointProjector::setup(const k4a_calibration_t& calibration, k4a_calibration_type_t sourceType, k4a_calibration_type_t targetType)
+	{
+		this->clear();
+
+		if (targetType != K4A_CALIBRATION_TYPE_DEPTH && targetType != K4A_CALIBRATION_TYPE_COLOR)
+		{
+			ofLogError(__FUNCTION__) << "Target type " << targetType << " is not a camera!";
+			return false;
+		}
+		if (sourceType < K4A_CALIBRATION_TYPE_DEPTH || sourceType >= K4A_CALIBRATION_TYPE_NUM)
+		{
+			ofLogError(__FUNCTION__) << "Invalid source type " << sourceType << "!";
+			return false;
+		}
+
+		this->camera = (targetType == K4A_CALIBRATION_TYPE_DEPTH) ? calibration.depth_camera_calibration : calibration.color_camera_calibration;
+		this->model.setup(this->camera);
+		if (!this->model.isSupported())
+		{
+			ofLogError(__FUNCTION__) << "Unsupported lens distortion model " << this->camera.intrinsics.type << "!";
+			return false;
+		}
+
+		// The SDK skips the extrinsics when the source is the target.
+		this->bIdentity = (sourceType == targetType);
+		if (!this->bIdentity)
+		{
+			const k4a_calibration_extrinsics_t& extrinsics = calibration.extrinsics[sourceType][targetType];
+			std::memcpy(this->rotation, extrinsics.rotation, sizeof(this->rotation));
+			std::memcpy(this->translation, extrinsics.translation, sizeof(this->translation));
+		}
+
+		this->bSetup = true;
+		return true;
+	}
+
+	void PointProjector::clear()
+	{
+		this->bSetup = false;
+		this->bIdentity = true;
+
+		std::fill(this->rotation, this->rotation + 9, 0.f);
+		this->rotation[0] = this->rotation[4] = this->rotation[8] = 1.f;
+		std::fill(this->translation, this->translation + 3, 0.f);
+	}
+
+	bool PointProjector::isSetup() const
+	{
+		return this->bSetup;
+	}
+
+	size_t PointProjector::project(const glm::vec3* points, size_t numPoints, glm::vec2* projPoints, uint8_t* valid) const
+	{
+		if (!this->bSetup)
+		{
+			ofLogError(__FUNCTION__) << "Set up projector before projecting!";
+			return 0;
+		}
+
+		size_t numValid = 0;
+		size_t i = 0;
+#ifdef OFX_K4A_X86
+		if (this->bUseSimd)
+		{
+			numValid = projectAvx2(this->rotation, this->translation, this->bIdentity, this->camera, points, numPoints, projPoints, valid);
+			i = numPoints - numPoints % 8;
+		}
+#endif
+
+		for (; i < numPoints; ++i)
+		{
+			const bool bValid = this->projectPoint(points[i], projPoints[i]);
+			if (valid) valid[i] = bValid ? 1 : 0;
+			if (bValid) ++numValid;
+		}
+
+		return numValid;
+	}
+
+	size_t PointProjector::project(const std::vector<glm::vec3>& points, std::vector<glm::vec2>& projPoints) const
+	{
+		projPoints.resize(points.size());
+		return this->project(points.data(), points.size(), projPoints.data());
+	}
+
+	void PointProjector::setUseSimd(bool useSimd)
+	{
+		if (useSimd && !PointCloudBuilder::isKernelSupported(PointCloudBuilder::KERNEL_AVX2))
+		{
+			ofLogWarning(__FUNCTION__) << "AVX2 not supported on this CPU, ignoring.";
+			return;
+		}
+
+		this->bUseSimd = useSimd;
+	}
+
+	bool PointProjector::getUseSimd() const
+	{
+		return this->bUseSimd;
+	}
+
+	bool PointProjector::projectPoint(const glm::vec3& point, glm::vec2& projPoint) const
+	{
+		float p[3] = { point.x, point.y, point.z };
+		if (!this->bIdentity)
+		{
+			const float* r = this->rotation;
+			p[0] = r[0] * point.x + r[1] * point.y + r[2] * point.z + this->translation[0];
+			p[1] = r[3] * point.x + r[4] * point.y + r[5] * point.z + this->translation[1];
+			p[2] = r[6] * point.x + r[7] * point.y + r[8] * point.z + this->translation[2];
+		}
+
+		if (p[2] > 0.f && this->model.project(p[0] / p[2], p[1] / p[2], projPoint.x, projPoint.y))
+		{
+			return true;
+		}
+
+		projPoint = glm::vec2(0.f);
+		return false;
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+
+#include <k4a/k4a.hpp>
+
+#include "ofVectorMath.h"
+
+#include "CameraModel.h"
+
+namespace ofxAzureKinect
+{
+	// Projects batches of 3D points from one camera's space into another camera's image,
+	// matching calibration.convert_3d_to_2d without going through the SDK for every point.
+	// The extrinsics and target lens model are taken once at setup, and batches are
+	// projected 8 points at a time with AVX2 when the CPU has it.
+	class PointProjector
+	{
+	public:
+		PointProjector();
+
+		bool setup(const k4a_calibration_t& calibration, k4a_calibration_type_t sourceType, k4a_calibration_type_t targetType);
+		void clear();
+
+		bool isSetup() const;
+
+		// Points are in mm in the source camera space. Points that can't be projected are set to 0,
+		// and flagged in valid if it is not null. Returns the number of valid points.
+		size_t project(const glm::vec3* points, size_t numPoints, glm::vec2* projPoints, uint8_t* valid = nullptr) const;
+		size_t project(const std::vector<glm::vec3>& points, std::vector<glm::vec2>& projPoints) const;
+
+		void setUseSimd(bool useSimd);
+		bool getUseSimd() const;
+
+	private:
+		bool projectPoint(const glm::vec3& point, glm::vec2& projPoint) const;
+
+	private:
+		bool bSetup;
+		bool bIdentity;
+		bool bUseSimd;
+
+		k4a_calibration_camera_t camera;
+		CameraModel model;
+
+		float rotation[9];
+		float translation[3];
+	};
+}
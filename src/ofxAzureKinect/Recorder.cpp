@@ -1,9 +1,17 @@
 #include "Recorder.h"
 
+#include <cstring>
+
+#include "BodySerializer.h"
+
 namespace ofxAzureKinect
 {
+	const char* Recorder::SKELETON_TRACK_NAME = "OFX_BODY_SKELETONS";
+	const char* Recorder::SKELETON_CODEC_ID = "S_OFX/K4ABT_SKELETONS";
+
 	Recorder::Recorder()
 		: bOpen(false)
+		, bRecordSkeletons(false)
 	{
 
 	}
@@ -13,8 +21,10 @@ namespace ofxAzureKinect
 		this->close();
 	}
 
-	bool Recorder::open(const k4a::device& device, k4a_device_configuration_t config, std::string filepath)
+	bool Recorder::open(const k4a::device& device, k4a_device_configuration_t config, std::string filepath, bool recordSkeletons)
 	{
+		std::unique_lock<std::mutex> lock(this->recordMutex);
+
 		if (this->bOpen) return false;
 
 		if (filepath.empty())
@@ -27,8 +37,19 @@ namespace ofxAzureKinect
 		try
 		{
 			this->record = k4a::record::create(filepath.c_str(), device, config);
-			
-			// TODO: Add IMU and other custom tracks here.
+
+			if (recordSkeletons)
+			{
+				// Codec context holds the encoding version and joint count, so readers can check they match.
+				std::vector<uint8_t> codecContext(2 * sizeof(uint32_t));
+				const uint32_t contextValues[2] = { BodySerializer::VERSION, K4ABT_JOINT_COUNT };
+				std::memcpy(codecContext.data(), contextValues, codecContext.size());
+
+				k4a_record_subtitle_settings_t trackSettings;
+				trackSettings.high_freq_data = false;
+
+				this->record.add_custom_subtitle_track(SKELETON_TRACK_NAME, SKELETON_CODEC_ID, codecContext.data(), codecContext.size(), &trackSettings);
+			}
 
 			// Write header after all track metadata is setup.
 			this->record.write_header();
@@ -41,12 +62,15 @@ namespace ofxAzureKinect
 
 		ofLogNotice(__FUNCTION__) << "Open success, writing to file " << filepath;
 
+		this->bRecordSkeletons = recordSkeletons;
 		this->bOpen = true;
 		return true;
 	}
 
 	bool Recorder::close()
 	{
+		std::unique_lock<std::mutex> lock(this->recordMutex);
+
 		if (!this->bOpen) return false;
 
 		this->record.flush();
@@ -54,12 +78,15 @@ namespace ofxAzureKinect
 
 		ofLogNotice(__FUNCTION__) << "Close success";
 
+		this->bRecordSkeletons = false;
 		this->bOpen = false;
 		return true;
 	}
 
 	bool Recorder::writeCapture(const k4a::capture& capture)
 	{
+		std::unique_lock<std::mutex> lock(this->recordMutex);
+
 		if (!this->isOpen())
 		{
 			ofLogError(__FUNCTION__) << "Open recorder before writing!";
@@ -70,8 +97,37 @@ namespace ofxAzureKinect
 		return true;
 	}
 
+	bool Recorder::writeBodyFrame(const BodyFrame& frame)
+	{
+		std::unique_lock<std::mutex> lock(this->recordMutex);
+
+		if (!this->isOpen() || !this->bRecordSkeletons)
+		{
+			ofLogError(__FUNCTION__) << "Open recorder with a skeleton track before writing!";
+			return false;
+		}
+
+		// Keyed to the device timestamp of the capture, so playback can match it back up.
+		this->skeletonData.clear();
+		BodySerializer::writeSkeletons(frame.bodySkeletons, this->skeletonData);
+
+		try
+		{
+			this->record.write_custom_track_data(SKELETON_TRACK_NAME, frame.timestamp, this->skeletonData.data(), this->skeletonData.size());
+		}
+		catch (const k4a::error& e)
+		{
+			ofLogError(__FUNCTION__) << e.what();
+			return false;
+		}
+
+		return true;
+	}
+
 	bool Recorder::addTag(const std::string& name, const std::string& value)
 	{
+		std::unique_lock<std::mutex> lock(this->recordMutex);
+
 		if (!this->isOpen())
 		{
 			ofLogError(__FUNCTION__) << "Open recorder before writing!";
@@ -86,4 +142,9 @@ namespace ofxAzureKinect
 	{
 		return this->bOpen;
 	}
+
+	bool Recorder::isRecordingSkeletons() const
+	{
+		return this->bOpen && this->bRecordSkeletons;
+	}
 }
\ No newline at end of file
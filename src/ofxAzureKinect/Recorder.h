@@ -1,28 +1,46 @@
 #pragma once
 
+#include <chrono>
+#include <mutex>
+#include <vector>
+
 #include <k4arecord/record.hpp>
 
 #include "ofParameter.h"
 
+#include "BodyTracker.h"
+
 namespace ofxAzureKinect
 {
 	class Recorder
 	{
+	public:
+		// Custom track holding one BodySerializer skeleton block per tracked capture.
+		static const char* SKELETON_TRACK_NAME;
+		static const char* SKELETON_CODEC_ID;
+
 	public:
 		Recorder();
 		~Recorder();
 
-		bool open(const k4a::device& device, k4a_device_configuration_t config, std::string filepath);
+		bool open(const k4a::device& device, k4a_device_configuration_t config, std::string filepath, bool recordSkeletons = false);
 		bool close();
 
 		bool writeCapture(const k4a::capture& capture);
+		bool writeBodyFrame(const BodyFrame& frame);
 
 		bool addTag(const std::string& name, const std::string& value);
 
 		bool isOpen() const;
+		bool isRecordingSkeletons() const;
 
 	private:
 		bool bOpen;
+		bool bRecordSkeletons;
+
+		// Captures and tracker results are written from different threads.
+		std::mutex recordMutex;
+		std::vector<uint8_t> skeletonData;
 
 		k4a::record record;
 	};
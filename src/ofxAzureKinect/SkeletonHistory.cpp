@@ -0,0 +1,218 @@
+#include "SkeletonHistory.h"
+
+#include <algorithm>
+
+namespace ofxAzureKinect
+{
+	const SkeletonHistory::Sample& SkeletonHistory::Body::get(size_t i) const
+	{
+		// Oldest first, the head is the newest.
+		const size_t size = this->samples.size();
+		return this->samples[(this->head + size - (this->count - 1) + i) % size];
+	}
+
+	SkeletonHistory::SkeletonHistory()
+		: historySize(0)
+		, maxExtrapolation(0)
+		, numFrames(0)
+		, latestTimestamp(0)
+	{}
+
+	void SkeletonHistory::setup(size_t historySize, std::chrono::microseconds maxExtrapolation)
+	{
+		std::unique_lock<std::mutex> lock(this->mutex);
+
+		this->historySize = historySize;
+		this->maxExtrapolation = maxExtrapolation;
+
+		this->bodies.clear();
+		this->latestIds.clear();
+		this->numFrames = 0;
+		this->latestTimestamp = std::chrono::microseconds(0);
+	}
+
+	void SkeletonHistory::clear()
+	{
+		this->setup(this->historySize, this->maxExtrapolation);
+	}
+
+	void SkeletonHistory::add(std::chrono::microseconds timestamp, const std::vector<BodySkeleton>& skeletons)
+	{
+		std::unique_lock<std::mutex> lock(this->mutex);
+
+		if (this->historySize == 0) return;
+
+		if (timestamp <= this->latestTimestamp)
+		{
+			// Time went backwards, after a seek or a loop, start over.
+			for (auto& body : this->bodies)
+			{
+				body.count = 0;
+			}
+		}
+
+		++this->numFrames;
+		this->latestTimestamp = timestamp;
+		this->latestTime = std::chrono::steady_clock::now();
+		this->latestIds.clear();
+
+		for (const auto& skeleton : skeletons)
+		{
+			auto it = std::find_if(this->bodies.begin(), this->bodies.end(), [&](const Body& body)
+			{
+				return body.count > 0 && body.id == skeleton.id;
+			});
+			if (it == this->bodies.end())
+			{
+				// Reuse the slot of a body that has left, if any.
+				it = std::find_if(this->bodies.begin(), this->bodies.end(), [](const Body& body)
+				{
+					return body.count == 0;
+				});
+				if (it == this->bodies.end())
+				{
+					this->bodies.emplace_back();
+					it = this->bodies.end() - 1;
+					it->samples.resize(this->historySize);
+				}
+
+				it->id = skeleton.id;
+				it->head = 0;
+				it->count = 0;
+			}
+
+			Body& body = *it;
+			body.head = (body.count == 0) ? 0 : (body.head + 1) % body.samples.size();
+			body.samples[body.head].timestamp = timestamp;
+			body.samples[body.head].skeleton = skeleton;
+			body.count = std::min(body.count + 1, body.samples.size());
+			body.lastFrame = this->numFrames;
+
+			this->latestIds.push_back(skeleton.id);
+		}
+
+		// Forget bodies that have been gone for longer than the history covers.
+		for (auto& body : this->bodies)
+		{
+			if (body.count > 0 && this->numFrames - body.lastFrame >= this->historySize)
+			{
+				body.count = 0;
+			}
+		}
+	}
+
+	bool SkeletonHistory::sample(uint32_t id, std::chrono::microseconds timestamp, BodySkeleton& skeleton) const
+	{
+		std::unique_lock<std::mutex> lock(this->mutex);
+
+		for (const auto& body : this->bodies)
+		{
+			if (body.count > 0 && body.id == id)
+			{
+				return this->sampleBody(body, timestamp, skeleton);
+			}
+		}
+
+		return false;
+	}
+
+	size_t SkeletonHistory::sampleAll(std::chrono::microseconds timestamp, std::vector<BodySkeleton>& skeletons) const
+	{
+		std::unique_lock<std::mutex> lock(this->mutex);
+
+		skeletons.resize(this->latestIds.size());
+		size_t numSampled = 0;
+		for (uint32_t id : this->latestIds)
+		{
+			for (const auto& body : this->bodies)
+			{
+				if (body.count > 0 && body.id == id && this->sampleBody(body, timestamp, skeletons[numSampled]))
+				{
+					++numSampled;
+					break;
+				}
+			}
+		}
+
+		skeletons.resize(numSampled);
+		return numSampled;
+	}
+
+	size_t SkeletonHistory::getHistorySize() const
+	{
+		return this->historySize;
+	}
+
+	std::chrono::microseconds SkeletonHistory::getLatestTimestamp() const
+	{
+		std::unique_lock<std::mutex> lock(this->mutex);
+		return this->latestTimestamp;
+	}
+
+	std::chrono::microseconds SkeletonHistory::getEstimatedTimestamp() const
+	{
+		std::unique_lock<std::mutex> lock(this->mutex);
+		if (this->latestTimestamp.count() == 0) return this->latestTimestamp;
+
+		return this->latestTimestamp + std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - this->latestTime);
+	}
+
+	bool SkeletonHistory::sampleBody(const Body& body, std::chrono::microseconds timestamp, BodySkeleton& skeleton) const
+	{
+		if (body.count == 0) return false;
+
+		const Sample* from = nullptr;
+		const Sample* to = nullptr;
+		float alpha = 0.f;
+
+		const Sample& newest = body.get(body.count - 1);
+		const Sample& oldest = body.get(0);
+		if (timestamp >= newest.timestamp)
+		{
+			from = (body.count > 1) ? &body.get(body.count - 2) : nullptr;
+			to = &newest;
+			if (!from || this->maxExtrapolation.count() <= 0 || timestamp == newest.timestamp)
+			{
+				skeleton = newest.skeleton;
+				return true;
+			}
+
+			// Carry on from the last two results, for a short while only.
+			const auto ahead = std::min(timestamp - newest.timestamp, this->maxExtrapolation);
+			alpha = 1.f + static_cast<float>(ahead.count()) / static_cast<float>((to->timestamp - from->timestamp).count());
+		}
+		else if (timestamp <= oldest.timestamp)
+		{
+			skeleton = oldest.skeleton;
+			return true;
+		}
+		else
+		{
+			// Find the results on either side, searching back from the newest.
+			size_t i = body.count - 1;
+			while (i > 0 && body.get(i - 1).timestamp > timestamp)
+			{
+				--i;
+			}
+
+			from = &body.get(i - 1);
+			to = &body.get(i);
+			alpha = static_cast<float>((timestamp - from->timestamp).count()) / static_cast<float>((to->timestamp - from->timestamp).count());
+		}
+
+		skeleton.id = body.id;
+		for (size_t j = 0; j < K4ABT_JOINT_COUNT; ++j)
+		{
+			const BodyJoint& a = from->skeleton.joints[j];
+			const BodyJoint& b = to->skeleton.joints[j];
+			BodyJoint& joint = skeleton.joints[j];
+
+			joint.position = glm::mix(a.position, b.position, alpha);
+			joint.orientation = glm::normalize(glm::slerp(a.orientation, b.orientation, alpha));
+			joint.confidenceLevel = std::min(a.confidenceLevel, b.confidenceLevel);
+			joint.projPos = glm::mix(a.projPos, b.projPos, alpha);
+		}
+
+		return true;
+	}
+}
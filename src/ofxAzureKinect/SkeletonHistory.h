@@ -0,0 +1,72 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include "BodySkeleton.h"
+
+namespace ofxAzureKinect
+{
+	// Bounded history of skeletons per body id, keyed by device timestamp.
+	// Bodies can be sampled at any timestamp: joint positions are lerped and orientations
+	// slerped between the two surrounding results, and extrapolated from the last two
+	// results for a short time past the latest one.
+	// Results are added from the tracker thread and sampled from any other thread.
+	class SkeletonHistory
+	{
+	public:
+		SkeletonHistory();
+
+		void setup(size_t historySize, std::chrono::microseconds maxExtrapolation);
+		void clear();
+
+		void add(std::chrono::microseconds timestamp, const std::vector<BodySkeleton>& skeletons);
+
+		// Returns false if the body has no results in the history.
+		bool sample(uint32_t id, std::chrono::microseconds timestamp, BodySkeleton& skeleton) const;
+
+		// Samples every body in the latest result.
+		size_t sampleAll(std::chrono::microseconds timestamp, std::vector<BodySkeleton>& skeletons) const;
+
+		size_t getHistorySize() const;
+
+		std::chrono::microseconds getLatestTimestamp() const;
+
+		// Device time now, estimated from the latest timestamp and how long ago it was added.
+		std::chrono::microseconds getEstimatedTimestamp() const;
+
+	private:
+		struct Sample
+		{
+			std::chrono::microseconds timestamp;
+			BodySkeleton skeleton;
+		};
+
+		struct Body
+		{
+			uint32_t id;
+			std::vector<Sample> samples;
+			size_t head;
+			size_t count;
+			uint64_t lastFrame;
+
+			const Sample& get(size_t i) const;
+		};
+
+		bool sampleBody(const Body& body, std::chrono::microseconds timestamp, BodySkeleton& skeleton) const;
+
+	private:
+		size_t historySize;
+		std::chrono::microseconds maxExtrapolation;
+
+		std::vector<Body> bodies;
+		std::vector<uint32_t> latestIds;
+		uint64_t numFrames;
+
+		std::chrono::microseconds latestTimestamp;
+		std::chrono::steady_clock::time_point latestTime;
+
+		mutable std::mutex mutex;
+	};
+}
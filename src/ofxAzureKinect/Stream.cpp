@@ -1,5 +1,15 @@
 #include "Stream.h"
 
+#include <algorithm>
+
+#include "ofUtils.h"
+
+#include "CameraModel.h"
+#include "HalfFloat.h"
+#include "WorkerPool.h"
+
+const std::string WORLD_TABLE_CACHE_DIR = "ofxAzureKinect/cache";
+
 namespace ofxAzureKinect
 {
 	Stream::Stream()
@@ -7,17 +17,27 @@ namespace ofxAzureKinect
 		, bStreaming(false)
 		, bNewFrame(false)
 		, serialNumber("")
-		, pixFrameNum(0)
-		, texFrameNum(0)
 		, bUpdateColor(false)
 		, bUpdateIr(false)
 		, bUpdateWorld(false)
 		, bUpdateVbo(false)
 		, bForceVboToDepthSize(false)
+		, bCacheWorldTables(false)
+		, bHalfFloatWorldTables(false)
+		, bBodyPointClouds(false)
+		, bBackgroundPointCloud(true)
+		, bHeadless(false)
+		, bBodyIndexSizeWarned(false)
 		, jpegDecompressor(tjInitDecompress())
-		, numPoints(0)
+		, bColorDecoded(false)
+		, numDecodeThreads(0)
+		, jpegDecodeDownscale(1)
+		, colorDecodeTicket(0)
+		, numPointCloudThreads(1)
 		, numSuccessiveFails(0)
-	{}
+	{
+		this->resetFrames();
+	}
 
 	Stream::~Stream()
 	{
@@ -28,22 +48,7 @@ namespace ofxAzureKinect
 	{
 		if (this->setupImageToWorldTable(K4A_CALIBRATION_TYPE_DEPTH, this->depthToWorldImg))
 		{
-			const int width = this->depthToWorldImg.get_width_pixels();
-			const int height = this->depthToWorldImg.get_height_pixels();
-
-			const auto data = reinterpret_cast<float*>(this->depthToWorldImg.get_buffer());
-
-			if (!this->depthToWorldPix.isAllocated())
-			{
-				this->depthToWorldPix.allocate(width, height, 2);
-				this->depthToWorldTex.allocate(width, height, GL_RG32F);
-				this->depthToWorldTex.setTextureMinMagFilter(GL_NEAREST, GL_NEAREST);
-			}
-
-			this->depthToWorldPix.setFromPixels(data, width, height, 2);
-			this->depthToWorldTex.loadData(this->depthToWorldPix);
-
-			return true;
+			return this->setupWorldTableStorage(this->depthToWorldImg, this->depthToWorldPix, this->depthToWorldHalfPix, this->depthToWorldTex);
 		}
 
 		return false;
@@ -53,25 +58,84 @@ namespace ofxAzureKinect
 	{
 		if (this->setupImageToWorldTable(K4A_CALIBRATION_TYPE_COLOR, this->colorToWorldImg))
 		{
-			const int width = this->colorToWorldImg.get_width_pixels();
-			const int height = this->colorToWorldImg.get_height_pixels();
+			return this->setupWorldTableStorage(this->colorToWorldImg, this->colorToWorldPix, this->colorToWorldHalfPix, this->colorToWorldTex);
+		}
+
+		return false;
+	}
 
-			const auto data = reinterpret_cast<float*>(this->colorToWorldImg.get_buffer());
+	bool Stream::setupWorldTableStorage(k4a::image& img, ofFloatPixels& pix, ofShortPixels& halfPix, ofTexture& tex)
+	{
+		const int width = img.get_width_pixels();
+		const int height = img.get_height_pixels();
 
-			if (!this->colorToWorldPix.isAllocated())
+		if (this->bHalfFloatWorldTables)
+		{
+			// Convert to half floats and let go of the full precision table.
+			k4a::image halfImg;
+			try
 			{
-				this->colorToWorldPix.allocate(width, height, 2);
-				this->colorToWorldTex.allocate(width, height, GL_RG32F);
-				this->colorToWorldTex.setTextureMinMagFilter(GL_NEAREST, GL_NEAREST);
+				halfImg = k4a::image::create(K4A_IMAGE_FORMAT_CUSTOM,
+					width, height,
+					width * 2 * static_cast<int>(sizeof(uint16_t)));
+			}
+			catch (const k4a::error& e)
+			{
+				ofLogError(__FUNCTION__) << e.what();
+				return false;
 			}
 
-			this->colorToWorldPix.setFromPixels(data, width, height, 2);
-			this->colorToWorldTex.loadData(this->colorToWorldPix);
+			const auto data = reinterpret_cast<const float*>(img.get_buffer());
+			const auto halfData = reinterpret_cast<uint16_t*>(halfImg.get_buffer());
+			for (int i = 0; i < width * height * 2; ++i)
+			{
+				halfData[i] = floatToHalf(data[i]);
+			}
 
-			return true;
+			img = halfImg;
+
+			// The pixels point into the image, which remains the only copy on the CPU.
+			pix.clear();
+			halfPix.setFromExternalPixels(halfData, width, height, 2);
+
+			if (this->bHeadless) return true;
+
+			if (!tex.isAllocated() || tex.getWidth() != width || tex.getHeight() != height)
+			{
+				tex.allocate(width, height, GL_RG16F);
+				tex.setTextureMinMagFilter(GL_NEAREST, GL_NEAREST);
+			}
+			tex.loadData(halfData, width, height, GL_RG, GL_HALF_FLOAT);
+		}
+		else
+		{
+			// The pixels point into the image, which remains the only copy on the CPU.
+			halfPix.clear();
+			pix.setFromExternalPixels(reinterpret_cast<float*>(img.get_buffer()), width, height, 2);
+
+			if (this->bHeadless) return true;
+
+			if (!tex.isAllocated() || tex.getWidth() != width || tex.getHeight() != height)
+			{
+				tex.allocate(width, height, GL_RG32F);
+				tex.setTextureMinMagFilter(GL_NEAREST, GL_NEAREST);
+			}
+			tex.loadData(pix);
 		}
 
-		return false;
+		return true;
+	}
+
+	void Stream::resetWorldTables()
+	{
+		// Pixels point into the images, clear them first.
+		this->depthToWorldPix.clear();
+		this->depthToWorldHalfPix.clear();
+		this->depthToWorldImg.reset();
+
+		this->colorToWorldPix.clear();
+		this->colorToWorldHalfPix.clear();
+		this->colorToWorldImg.reset();
 	}
 
 	bool Stream::setupImageToWorldTable(k4a_calibration_type_t type, k4a::image& img)
@@ -82,6 +146,19 @@ namespace ofxAzureKinect
 			calibrationCamera.resolution_width,
 			calibrationCamera.resolution_height);
 
+		uint64_t cacheKey = 0;
+		std::string cachePath;
+		if (this->bCacheWorldTables)
+		{
+			cacheKey = WorldTableCache::makeKey(this->getRawCalibration(), this->calibration, type);
+			cachePath = WorldTableCache::getFilePath(ofToDataPath(WORLD_TABLE_CACHE_DIR, true), type, cacheKey);
+			if (WorldTableCache::load(cachePath, cacheKey, dims.x, dims.y, img))
+			{
+				ofLogVerbose(__FUNCTION__) << "Loaded world table from " << cachePath;
+				return true;
+			}
+		}
+
 		try
 		{
 			img = k4a::image::create(K4A_IMAGE_FORMAT_CUSTOM,
@@ -96,46 +173,103 @@ namespace ofxAzureKinect
 
 		auto imgData = reinterpret_cast<k4a_float2_t*>(img.get_buffer());
 
-		k4a_float2_t p;
-		k4a_float3_t ray;
-		int idx = 0;
-		for (int y = 0; y < dims.y; ++y)
+		// Split the rows over all cores.
+		WorkerPool workerPool;
+		workerPool.setup(std::max(std::thread::hardware_concurrency(), 1u));
+		const size_t numBands = std::min(workerPool.getNumThreads() * 4, static_cast<size_t>(dims.y));
+		const auto getBandRows = [&](size_t i)
 		{
-			p.xy.y = static_cast<float>(y);
+			return glm::ivec2(dims.y * i / numBands, dims.y * (i + 1) / numBands);
+		};
 
-			for (int x = 0; x < dims.x; ++x)
+		// Evaluate the lens model directly when we can, and make sure it agrees with the SDK.
+		const CameraModel cameraModel(calibrationCamera);
+		bool bUseCameraModel = cameraModel.isSupported();
+		if (bUseCameraModel)
+		{
+			workerPool.run(numBands, [&](size_t i)
 			{
-				p.xy.x = static_cast<float>(x);
+				const auto rows = getBandRows(i);
+				cameraModel.unprojectRows(rows.x, rows.y, imgData);
+			});
 
-				if (this->calibration.convert_2d_to_3d(p, 1.f, type, type, &ray))
-				{
-					imgData[idx].xy.x = ray.xyz.x;
-					imgData[idx].xy.y = ray.xyz.y;
-				}
-				else
+			bUseCameraModel = cameraModel.matchesSdk(this->calibration, type, imgData);
+			if (!bUseCameraModel)
+			{
+				ofLogWarning(__FUNCTION__) << "Camera model does not match the SDK, falling back to convert_2d_to_3d.";
+			}
+		}
+
+		if (!bUseCameraModel)
+		{
+			workerPool.run(numBands, [&](size_t i)
+			{
+				const auto rows = getBandRows(i);
+
+				k4a_float2_t p;
+				k4a_float3_t ray;
+				int idx = rows.x * dims.x;
+				for (int y = rows.x; y < rows.y; ++y)
 				{
-					// The pixel is invalid.
-					//ofLogNotice(__FUNCTION__) << "Pixel " << depthToWorldData[idx].xy.x << ", " << depthToWorldData[idx].xy.y << " is invalid";
-					imgData[idx].xy.x = 0;
-					imgData[idx].xy.y = 0;
+					p.xy.y = static_cast<float>(y);
+
+					for (int x = 0; x < dims.x; ++x)
+					{
+						p.xy.x = static_cast<float>(x);
+
+						bool bValid = false;
+						try
+						{
+							bValid = this->calibration.convert_2d_to_3d(p, 1.f, type, type, &ray);
+						}
+						catch (const k4a::error& e)
+						{
+							ofLogError(__FUNCTION__) << e.what();
+						}
+
+						if (bValid)
+						{
+							imgData[idx].xy.x = ray.xyz.x;
+							imgData[idx].xy.y = ray.xyz.y;
+						}
+						else
+						{
+							// The pixel is invalid.
+							imgData[idx].xy.x = 0;
+							imgData[idx].xy.y = 0;
+						}
+
+						++idx;
+					}
 				}
+			});
+		}
 
-				++idx;
-			}
+		if (this->bCacheWorldTables && WorldTableCache::save(cachePath, cacheKey, img))
+		{
+			ofLogVerbose(__FUNCTION__) << "Saved world table to " << cachePath;
 		}
 
 		return true;
 	}
 
-	bool Stream::setupTransformationImages()
+	std::vector<uint8_t> Stream::getRawCalibration() const
+	{
+		return std::vector<uint8_t>();
+	}
+
+	bool Stream::setupTransformationImages(Frame& frame)
 	{
+		// Each frame keeps its own transformation targets so that they can be handed out without copying.
+		if (frame.colorInDepthImg && frame.depthInColorImg) return true;
+
 		const auto depthDims = glm::ivec2(
 			this->calibration.depth_camera_calibration.resolution_width,
 			this->calibration.depth_camera_calibration.resolution_height);
 
 		try
 		{
-			this->colorInDepthImg = k4a::image::create(K4A_IMAGE_FORMAT_COLOR_BGRA32,
+			frame.colorInDepthImg = k4a::image::create(K4A_IMAGE_FORMAT_COLOR_BGRA32,
 				depthDims.x, depthDims.y,
 				depthDims.x * 4 * static_cast<int>(sizeof(uint8_t)));
 		}
@@ -151,7 +285,7 @@ namespace ofxAzureKinect
 
 		try
 		{
-			this->depthInColorImg = k4a::image::create(K4A_IMAGE_FORMAT_DEPTH16,
+			frame.depthInColorImg = k4a::image::create(K4A_IMAGE_FORMAT_DEPTH16,
 				colorDims.x, colorDims.y,
 				colorDims.x * static_cast<int>(sizeof(uint16_t)));
 		}
@@ -168,8 +302,34 @@ namespace ofxAzureKinect
 	{
 		if (this->bStreaming) return false;
 
+		this->resetFrames();
+
+		if (!JpegDecoder::isValidDownscale(this->jpegDecodeDownscale))
+		{
+			ofLogWarning(__FUNCTION__) << "Unsupported JPEG decode downscale " << this->jpegDecodeDownscale << ", must be 1, 2, 4 or 8! Decoding at full size.";
+			this->jpegDecodeDownscale = 1;
+		}
+		else if (this->jpegDecodeDownscale != 1 && this->bUpdateColor && this->getColorFormat() != K4A_IMAGE_FORMAT_COLOR_MJPG)
+		{
+			ofLogWarning(__FUNCTION__) << "JPEG decode downscale only applies to MJPG color, ignoring.";
+			this->jpegDecodeDownscale = 1;
+		}
+
+		if (this->bUpdateColor && this->getColorFormat() == K4A_IMAGE_FORMAT_COLOR_MJPG && this->numDecodeThreads > 0)
+		{
+			this->jpegDecoder.setup(this->numDecodeThreads, this->jpegDecodeDownscale);
+		}
+
+		if (this->bUpdateVbo)
+		{
+			this->pointCloudBuilder.setup(this->numPointCloudThreads);
+		}
+
 		this->startThread();
-		ofAddListener(ofEvents().update, this, &Stream::update);
+		if (!this->bHeadless)
+		{
+			ofAddListener(ofEvents().update, this, &Stream::update);
+		}
 
 		this->numSuccessiveFails = 0;
 		this->bStreaming = true;
@@ -181,13 +341,25 @@ namespace ofxAzureKinect
 	{
 		if (!this->bStreaming) return false;
 
-		this->stopBodyTracker();
-
-		std::unique_lock<std::mutex> lock(this->mutex);
 		this->stopThread();
-		this->condition.notify_all();
+		if (!this->isCurrentThread())
+		{
+			// Let the capture thread finish its current frame.
+			this->waitForThread(false);
+		}
+
+		if (!this->bHeadless)
+		{
+			ofRemoveListener(ofEvents().update, this, &Stream::update);
+		}
 
-		ofRemoveListener(ofEvents().update, this, &Stream::update);
+		this->jpegDecoder.close();
+		this->pendingCaptures.clear();
+		this->colorDecodeTicket = 0;
+
+		this->pointCloudBuilder.close();
+
+		this->stopBodyTracker();
 
 		this->numSuccessiveFails = 0;
 		this->bStreaming = false;
@@ -195,6 +367,26 @@ namespace ofxAzureKinect
 		return true;
 	}
 
+	void Stream::resetFrames()
+	{
+		this->frameBuffer.reset();
+		for (size_t i = 0; i < this->frameBuffer.NUM_SLOTS; ++i)
+		{
+			this->frameBuffer.getSlot(i) = std::make_shared<Frame>();
+		}
+	}
+
+	std::shared_ptr<Frame> Stream::acquireFrame()
+	{
+		auto& frame = this->frameBuffer.getBack();
+		if (frame.use_count() > 1)
+		{
+			// The app is still holding on to this frame, start a fresh one instead of writing over it.
+			frame = std::make_shared<Frame>();
+		}
+		return frame;
+	}
+
 	bool Stream::startBodyTracker(BodyTrackerSettings trackerSettings)
 	{
 		if (trackerSettings.imageType == K4A_CALIBRATION_TYPE_COLOR && !this->bUpdateColor)
@@ -202,11 +394,15 @@ namespace ofxAzureKinect
 			ofLogWarning(__FUNCTION__) << "Cannot map tracker to color because color stream is disabled! Overriding to depth image.";
 			trackerSettings.imageType = K4A_CALIBRATION_TYPE_DEPTH;
 		}
+
+		// Don't change the tracker state while the capture thread is using it.
+		std::unique_lock<std::mutex> lock(this->mutex);
 		return this->bodyTracker.startTracking(this->calibration, trackerSettings);
 	}
 
 	bool Stream::stopBodyTracker()
 	{
+		std::unique_lock<std::mutex> lock(this->mutex);
 		return this->bodyTracker.stopTracking();
 	}
 
@@ -214,19 +410,41 @@ namespace ofxAzureKinect
 	{
 		while (this->isThreadRunning())
 		{
-			std::unique_lock<std::mutex> lock(this->mutex);
-
-			while (this->isThreadRunning() && this->texFrameNum != this->pixFrameNum)
+			if (this->updateCapture())
 			{
-				this->condition.wait(lock);
-			}
+				if (this->jpegDecoder.isRunning() && !this->queueColorDecode())
+				{
+					// Keep filling the decode pipeline.
+					this->numSuccessiveFails = 0;
+					continue;
+				}
 
-			if (this->isThreadRunning() && this->updateCapture())
-			{
-				this->updatePixels();
+				{
+					std::unique_lock<std::mutex> lock(this->mutex);
+					this->updatePixels();
+				}
 
 				this->releaseCapture();
 
+				if (this->bHeadless)
+				{
+					std::unique_lock<std::mutex> lock(this->callbackMutex);
+					if (this->frameCallback)
+					{
+						const std::shared_ptr<Frame> frame = this->frameBuffer.getBack();
+						this->frameCallback(frame);
+
+						// Only the buffer and this function still hold it.
+						if (frame.use_count() == 2)
+						{
+							frame->releaseSensorImages();
+						}
+					}
+				}
+
+				// Hand the frame over to the main thread, replacing any frame it has not picked up yet.
+				this->frameBuffer.publish();
+
 				this->numSuccessiveFails = 0;
 			}
 			else
@@ -240,13 +458,14 @@ namespace ofxAzureKinect
 	{
 		this->bNewFrame = false;
 
-		if (this->texFrameNum != this->pixFrameNum)
+		if (this->frameBuffer.swapFront())
 		{
-			std::unique_lock<std::mutex> lock(this->mutex);
-
 			this->updateTextures();
+		}
 
-			this->condition.notify_all();
+		if (this->bodyTracker.isTracking())
+		{
+			this->bodyTracker.updateTextures();
 		}
 	}
 
@@ -255,145 +474,179 @@ namespace ofxAzureKinect
 		this->capture.reset();
 	}
 
+	bool Stream::queueColorDecode()
+	{
+		// Start decoding the new capture right away, and process the oldest capture
+		// once there is one in flight per decoder thread.
+		PendingCapture pending;
+		pending.capture = std::move(this->capture);
+		pending.decodeTicket = this->jpegDecoder.submit(pending.capture.get_color_image());
+		this->pendingCaptures.push_back(std::move(pending));
+
+		if (this->pendingCaptures.size() <= this->jpegDecoder.getNumThreads())
+		{
+			return false;
+		}
+
+		this->capture = std::move(this->pendingCaptures.front().capture);
+		this->colorDecodeTicket = this->pendingCaptures.front().decodeTicket;
+		this->pendingCaptures.pop_front();
+
+		return true;
+	}
+
 	void Stream::updatePixels()
 	{
+		auto framePtr = this->acquireFrame();
+		Frame& frame = *framePtr;
+
 		// Probe for a depth16 image.
-		auto depthImg = this->capture.get_depth_image();
-		if (depthImg)
+		frame.depthImg = this->capture.get_depth_image();
+		if (frame.depthImg)
 		{
-			const auto depthDims = glm::ivec2(depthImg.get_width_pixels(), depthImg.get_height_pixels());
-			if (!depthPix.isAllocated())
-			{
-				this->depthPix.allocate(depthDims.x, depthDims.y, 1);
-			}
+			const auto depthDims = glm::ivec2(frame.depthImg.get_width_pixels(), frame.depthImg.get_height_pixels());
+			const auto depthData = reinterpret_cast<uint16_t*>(frame.depthImg.get_buffer());
+			frame.depthPix.setFromExternalPixels(depthData, depthDims.x, depthDims.y, 1);
+			frame.timestamp = frame.depthImg.get_device_timestamp();
 
-			const auto depthData = reinterpret_cast<uint16_t*>(depthImg.get_buffer());
-			this->depthPix.setFromPixels(depthData, depthDims.x, depthDims.y, 1);
-
-			ofLogVerbose(__FUNCTION__) << "Capture Depth16 " << depthDims.x << "x" << depthDims.y << " stride: " << depthImg.get_stride_bytes() << ".";
+			ofLogVerbose(__FUNCTION__) << "Capture Depth16 " << depthDims.x << "x" << depthDims.y << " stride: " << frame.depthImg.get_stride_bytes() << ".";
 		}
 		else
 		{
+			frame.depthPix.clear();
 			ofLogWarning(__FUNCTION__) << "No Depth16 capture found (" << ofGetFrameNum() << ")!";
 		}
 
-		k4a::image colorImg;
 		if (this->bUpdateColor)
 		{
 			// Probe for a color image.
-			colorImg = this->capture.get_color_image();
-			if (colorImg)
+			frame.colorImg = this->capture.get_color_image();
+			if (frame.colorImg)
 			{
-				const auto colorDims = glm::ivec2(colorImg.get_width_pixels(), colorImg.get_height_pixels());
-				if (!colorPix.isAllocated())
-				{
-					this->colorPix.allocate(colorDims.x, colorDims.y, OF_PIXELS_BGRA);
-				}
+				const auto colorDims = glm::ivec2(frame.colorImg.get_width_pixels(), frame.colorImg.get_height_pixels());
 
 				if (this->getColorFormat() == K4A_IMAGE_FORMAT_COLOR_MJPG)
 				{
-					const int decompressStatus = tjDecompress2(this->jpegDecompressor,
-						colorImg.get_buffer(),
-						static_cast<unsigned long>(colorImg.get_size()),
-						this->colorPix.getData(),
-						colorDims.x,
-						0, // pitch
-						colorDims.y,
-						TJPF_BGRA,
-						TJFLAG_FASTDCT | TJFLAG_FASTUPSAMPLE);
+					// Decompressed pixels are owned by the frame.
+					if (this->bColorDecoded)
+					{
+						// Already decoded ahead, swap the pixels in.
+						frame.colorPix.swap(this->decodedColorPix);
+					}
+					else if (this->colorDecodeTicket != 0)
+					{
+						// Already decoded by the pool, swap the pixels in.
+						this->jpegDecoder.wait(this->colorDecodeTicket, frame.colorPix);
+					}
+					else
+					{
+						JpegDecoder::decode(this->jpegDecompressor, frame.colorImg, frame.colorPix, this->jpegDecodeDownscale);
+					}
 				}
 				else
 				{
-					const auto colorData = reinterpret_cast<uint8_t*>(colorImg.get_buffer());
-					this->colorPix.setFromPixels(colorData, colorDims.x, colorDims.y, 4);
+					const auto colorData = reinterpret_cast<uint8_t*>(frame.colorImg.get_buffer());
+					frame.colorPix.setFromExternalPixels(colorData, colorDims.x, colorDims.y, OF_PIXELS_BGRA);
 				}
 
-				ofLogVerbose(__FUNCTION__) << "Capture Color " << colorDims.x << "x" << colorDims.y << " stride: " << colorImg.get_stride_bytes() << ".";
+				ofLogVerbose(__FUNCTION__) << "Capture Color " << colorDims.x << "x" << colorDims.y << " stride: " << frame.colorImg.get_stride_bytes() << " downscale: " << this->jpegDecodeDownscale << ".";
 			}
 			else
 			{
+				if (this->getColorFormat() != K4A_IMAGE_FORMAT_COLOR_MJPG)
+				{
+					frame.colorPix.clear();
+				}
 				ofLogWarning(__FUNCTION__) << "No Color capture found (" << ofGetFrameNum() << ")!";
 			}
 		}
 
-		k4a::image irImg;
+		if (this->colorDecodeTicket != 0)
+		{
+			if (!frame.colorImg)
+			{
+				// Collect the empty job so it doesn't linger in the decoder.
+				ofPixels unused;
+				this->jpegDecoder.wait(this->colorDecodeTicket, unused);
+			}
+			this->colorDecodeTicket = 0;
+		}
+		this->bColorDecoded = false;
+
 		if (this->bUpdateIr)
 		{
 			// Probe for a IR16 image.
-			irImg = this->capture.get_ir_image();
-			if (irImg)
+			frame.irImg = this->capture.get_ir_image();
+			if (frame.irImg)
 			{
-				const auto irDims = glm::ivec2(irImg.get_width_pixels(), irImg.get_height_pixels());
-				if (!this->irPix.isAllocated())
-				{
-					this->irPix.allocate(irDims.x, irDims.y, 1);
-				}
-
-				const auto irData = reinterpret_cast<uint16_t*>(irImg.get_buffer());
-				this->irPix.setFromPixels(irData, irDims.x, irDims.y, 1);
+				const auto irDims = glm::ivec2(frame.irImg.get_width_pixels(), frame.irImg.get_height_pixels());
+				const auto irData = reinterpret_cast<uint16_t*>(frame.irImg.get_buffer());
+				frame.irPix.setFromExternalPixels(irData, irDims.x, irDims.y, 1);
 
-				ofLogVerbose(__FUNCTION__) << "Capture Ir16 " << irDims.x << "x" << irDims.y << " stride: " << irImg.get_stride_bytes() << ".";
+				ofLogVerbose(__FUNCTION__) << "Capture Ir16 " << irDims.x << "x" << irDims.y << " stride: " << frame.irImg.get_stride_bytes() << ".";
 			}
 			else
 			{
+				frame.irPix.clear();
 				ofLogWarning(__FUNCTION__) << "No Ir16 capture found (" << ofGetFrameNum() << ")!";
 			}
 		}
 
-		if (colorImg && this->bUpdateColor && this->getColorFormat() == K4A_IMAGE_FORMAT_COLOR_BGRA32)
+		bool bDepthInColor = false;
+		if (frame.depthImg && this->bUpdateColor && this->setupTransformationImages(frame))
 		{
-			// TODO: Fix this for non-BGRA formats, maybe always keep a BGRA k4a::image around.
-			this->updateDepthInColorFrame(depthImg, colorImg);
-			this->updateColorInDepthFrame(depthImg, colorImg);
+			// Depth maps into color space for any color format, only BGRA color maps into depth space.
+			// TODO: Fix color in depth for non-BGRA formats, maybe always keep a BGRA k4a::image around.
+			bDepthInColor = this->updateDepthInColorFrame(frame.depthImg, frame.colorImg);
+
+			if (frame.colorImg && this->getColorFormat() == K4A_IMAGE_FORMAT_COLOR_BGRA32)
+			{
+				this->updateColorInDepthFrame(frame.depthImg, frame.colorImg);
+			}
 		}
 
 		if (this->bUpdateVbo)
 		{
-			if (this->bUpdateColor && !this->bForceVboToDepthSize)
+			if (bDepthInColor && !this->bForceVboToDepthSize)
 			{
-				this->updatePointsCache(this->depthInColorImg, this->colorToWorldImg);
+				this->updatePointsCache(frame.depthInColorImg, this->colorToWorldImg);
 			}
 			else
 			{
-				this->updatePointsCache(depthImg, this->depthToWorldImg);
+				this->updatePointsCache(frame.depthImg, this->depthToWorldImg);
 			}
 		}
 
 		if (this->bodyTracker.isTracking())
 		{
-			this->bodyTracker.processCapture(this->capture, this->calibration, this->transformation, depthImg);
+			this->bodyTracker.processCapture(this->capture);
 		}
-
-		// Release images.
-		depthImg.reset();
-		colorImg.reset();
-		irImg.reset();
-
-		// Update frame number.
-		this->pixFrameNum = ofGetFrameNum();
 	}
 
 	void Stream::updateTextures()
 	{
-		if (this->depthPix.isAllocated())
+		const Frame& frame = *this->frameBuffer.getFront();
+
+		if (frame.depthPix.isAllocated())
 		{
 			// Update the depth texture.
 			if (!this->depthTex.isAllocated())
 			{
-				this->depthTex.allocate(this->depthPix);
+				this->depthTex.allocate(frame.depthPix);
 				this->depthTex.setTextureMinMagFilter(GL_NEAREST, GL_NEAREST);
 			}
 
-			this->depthTex.loadData(this->depthPix);
+			this->depthTex.loadData(frame.depthPix);
 			ofLogVerbose(__FUNCTION__) << "Update Depth16 " << this->depthTex.getWidth() << "x" << this->depthTex.getHeight() << ".";
 		}
 
-		if (this->bUpdateColor && this->colorPix.isAllocated())
+		if (this->bUpdateColor && frame.colorPix.isAllocated())
 		{
-			// Update the color texture.
-			if (!this->colorTex.isAllocated())
+			// Update the color texture, its size depends on the decode scale.
+			if (!this->colorTex.isAllocated() ||
+				this->colorTex.getWidth() != frame.colorPix.getWidth() || this->colorTex.getHeight() != frame.colorPix.getHeight())
 			{
-				this->colorTex.allocate(this->colorPix);
+				this->colorTex.allocate(frame.colorPix);
 				this->colorTex.setTextureMinMagFilter(GL_NEAREST, GL_NEAREST);
 
 				if (this->getColorFormat() == K4A_IMAGE_FORMAT_COLOR_BGRA32)
@@ -407,48 +660,49 @@ namespace ofxAzureKinect
 				}
 			}
 
-			this->colorTex.loadData(this->colorPix);
+			this->colorTex.loadData(frame.colorPix);
 			ofLogVerbose(__FUNCTION__) << "Update Color " << this->colorTex.getWidth() << "x" << this->colorTex.getHeight() << ".";
 		}
 
-		if (this->bUpdateIr && this->irPix.isAllocated())
+		if (this->bUpdateIr && frame.irPix.isAllocated())
 		{
 			// Update the IR16 image.
 			if (!this->irTex.isAllocated())
 			{
-				this->irTex.allocate(this->irPix);
+				this->irTex.allocate(frame.irPix);
 				this->irTex.setTextureMinMagFilter(GL_NEAREST, GL_NEAREST);
 				this->irTex.setRGToRGBASwizzles(true);
 			}
 
-			this->irTex.loadData(this->irPix);
+			this->irTex.loadData(frame.irPix);
 			ofLogVerbose(__FUNCTION__) << "Update Ir16 " << this->irTex.getWidth() << "x" << this->irTex.getHeight() << ".";
 		}
 
 		if (this->bUpdateVbo)
 		{
-			this->pointCloudVbo.setVertexData(this->positionCache.data(), this->numPoints, GL_STREAM_DRAW);
-			this->pointCloudVbo.setTexCoordData(this->uvCache.data(), this->numPoints, GL_STREAM_DRAW);
+			this->pointCloudVbo.setVertexData(frame.positionCache.data(), frame.numPoints, GL_STREAM_DRAW);
+			this->pointCloudVbo.setTexCoordData(frame.uvCache.data(), frame.numPoints, GL_STREAM_DRAW);
 		}
 
-		if (this->bUpdateColor && this->getColorFormat() == K4A_IMAGE_FORMAT_COLOR_BGRA32)
+		if (this->bUpdateColor)
 		{
-			if (this->depthInColorPix.isAllocated())
+			// Depth in color is there for any color format.
+			if (frame.depthInColorPix.isAllocated())
 			{
 				if (!this->depthInColorTex.isAllocated())
 				{
-					this->depthInColorTex.allocate(this->depthInColorPix);
+					this->depthInColorTex.allocate(frame.depthInColorPix);
 					this->depthInColorTex.setTextureMinMagFilter(GL_NEAREST, GL_NEAREST);
 				}
 
-				this->depthInColorTex.loadData(this->depthInColorPix);
+				this->depthInColorTex.loadData(frame.depthInColorPix);
 			}
 
-			if (this->colorInDepthPix.isAllocated())
+			if (frame.colorInDepthPix.isAllocated() && this->getColorFormat() == K4A_IMAGE_FORMAT_COLOR_BGRA32)
 			{
 				if (!this->colorInDepthTex.isAllocated())
 				{
-					this->colorInDepthTex.allocate(this->colorInDepthPix);
+					this->colorInDepthTex.allocate(frame.colorInDepthPix);
 					this->colorInDepthTex.setTextureMinMagFilter(GL_NEAREST, GL_NEAREST);
 					this->colorInDepthTex.bind();
 					{
@@ -458,69 +712,72 @@ namespace ofxAzureKinect
 					this->colorInDepthTex.unbind();
 				}
 
-				this->colorInDepthTex.loadData(this->colorInDepthPix);
+				this->colorInDepthTex.loadData(frame.colorInDepthPix);
 			}
 		}
 
-		if (this->bodyTracker.isTracking())
-		{
-			this->bodyTracker.updateTextures();
-		}
-
-		// Update frame number.
-		this->texFrameNum = this->pixFrameNum;
 		this->bNewFrame = true;
 	}
 
 	bool Stream::updatePointsCache(k4a::image& frameImg, k4a::image& tableImg)
 	{
-		const auto frameDims = glm::ivec2(frameImg.get_width_pixels(), frameImg.get_height_pixels());
-		const auto tableDims = glm::ivec2(tableImg.get_width_pixels(), tableImg.get_height_pixels());
-		if (frameDims != tableDims)
+		Frame& frame = *this->frameBuffer.getBack();
+		frame.bodyPointRanges.clear();
+		frame.backgroundPointRange = BodyPointRange();
+		frame.bodyIndexTimestamp = std::chrono::microseconds(0);
+
+		std::chrono::microseconds bodyIndexTimestamp(0);
+		bool bSplitBodies = this->bBodyPointClouds && this->bodyTracker.isTracking() &&
+			this->bodyTracker.getLatestBodyIndex(this->bodyIndexImg, this->bodyIds, bodyIndexTimestamp);
+		if (bSplitBodies &&
+			(this->bodyIndexImg.get_width_pixels() != frameImg.get_width_pixels() || this->bodyIndexImg.get_height_pixels() != frameImg.get_height_pixels()))
 		{
-			ofLogError(__FUNCTION__) << "Image dims mismatch! " << frameDims << " vs " << tableDims;
-			return false;
+			// The body index map is in depth space, so bodies can only be split from depth sized clouds.
+			if (!this->bBodyIndexSizeWarned)
+			{
+				ofLogWarning(__FUNCTION__) << "Body point clouds need a depth sized point cloud, building the full cloud instead.";
+				this->bBodyIndexSizeWarned = true;
+			}
+			this->bodyIndexImg.reset();
+			bSplitBodies = false;
 		}
 
-		const auto frameData = reinterpret_cast<uint16_t*>(frameImg.get_buffer());
-		const auto tableData = reinterpret_cast<k4a_float2_t*>(tableImg.get_buffer());
-
-		this->positionCache.resize(frameDims.x * frameDims.y);
-		this->uvCache.resize(frameDims.x * frameDims.y);
-
-		int count = 0;
-		for (int y = 0; y < frameDims.y; ++y)
+		if (bSplitBodies)
 		{
-			for (int x = 0; x < frameDims.x; ++x)
+			const bool bSuccess = this->pointCloudBuilder.buildBodies(frameImg, tableImg, this->bodyIndexImg, this->bBackgroundPointCloud,
+				frame.positionCache, frame.uvCache, this->bodyBucketOffsets);
+			this->bodyIndexImg.reset();
+			if (!bSuccess) return false;
+
+			// Body index values are indices into the tracker's bodies, turn them into ids.
+			for (size_t i = 0; i < this->bodyIds.size(); ++i)
 			{
-				int idx = y * frameDims.x + x;
-				if (frameData[idx] != 0 &&
-					tableData[idx].xy.x != 0 && tableData[idx].xy.y != 0)
-				{
-					float depthVal = static_cast<float>(frameData[idx]);
-					this->positionCache[count] = glm::vec3(
-						tableData[idx].xy.x * depthVal,
-						tableData[idx].xy.y * depthVal,
-						depthVal
-					);
+				BodyPointRange range;
+				range.bodyId = this->bodyIds[i];
+				range.offset = this->bodyBucketOffsets[i];
+				range.count = this->bodyBucketOffsets[i + 1] - this->bodyBucketOffsets[i];
+				frame.bodyPointRanges.push_back(range);
+			}
 
-					this->uvCache[count] = glm::vec2(x, y);
+			frame.backgroundPointRange.bodyId = K4ABT_INVALID_BODY_ID;
+			frame.backgroundPointRange.offset = this->bodyBucketOffsets[K4ABT_BODY_INDEX_MAP_BACKGROUND];
+			frame.backgroundPointRange.count = this->bodyBucketOffsets.back() - frame.backgroundPointRange.offset;
 
-					++count;
-				}
-			}
+			frame.bodyIndexTimestamp = bodyIndexTimestamp;
+			frame.numPoints = this->bodyBucketOffsets.back();
+			return true;
 		}
 
-		this->numPoints = count;
-
-		return true;
+		return this->pointCloudBuilder.build(frameImg, tableImg, frame.positionCache, frame.uvCache, frame.numPoints);
 	}
 
 	bool Stream::updateDepthInColorFrame(const k4a::image& depthImg, const k4a::image& colorImg)
 	{
+		Frame& frame = *this->frameBuffer.getBack();
+
 		try
 		{
-			this->transformation.depth_image_to_color_camera(depthImg, &this->depthInColorImg);
+			this->transformation.depth_image_to_color_camera(depthImg, &frame.depthInColorImg);
 		}
 		catch (const k4a::error& e)
 		{
@@ -528,25 +785,21 @@ namespace ofxAzureKinect
 			return false;
 		}
 
-		const auto depthInColorData = reinterpret_cast<uint16_t*>(this->depthInColorImg.get_buffer());
-
-		if (!this->depthInColorPix.isAllocated())
-		{
-			this->depthInColorPix.allocate(this->depthInColorImg.get_width_pixels(), this->depthInColorImg.get_height_pixels(), 1);
-		}
-
-		this->depthInColorPix.setFromPixels(depthInColorData, this->depthInColorImg.get_width_pixels(), this->depthInColorImg.get_height_pixels(), 1);
+		const auto depthInColorData = reinterpret_cast<uint16_t*>(frame.depthInColorImg.get_buffer());
+		frame.depthInColorPix.setFromExternalPixels(depthInColorData, frame.depthInColorImg.get_width_pixels(), frame.depthInColorImg.get_height_pixels(), 1);
 
-		ofLogVerbose(__FUNCTION__) << "Depth in Color " << this->depthInColorImg.get_width_pixels() << "x" << this->depthInColorImg.get_height_pixels() << " stride: " << this->depthInColorImg.get_stride_bytes() << ".";
+		ofLogVerbose(__FUNCTION__) << "Depth in Color " << frame.depthInColorImg.get_width_pixels() << "x" << frame.depthInColorImg.get_height_pixels() << " stride: " << frame.depthInColorImg.get_stride_bytes() << ".";
 
 		return true;
 	}
 
 	bool Stream::updateColorInDepthFrame(const k4a::image& depthImg, const k4a::image& colorImg)
 	{
+		Frame& frame = *this->frameBuffer.getBack();
+
 		try
 		{
-			this->transformation.color_image_to_depth_camera(depthImg, colorImg, &this->colorInDepthImg);
+			this->transformation.color_image_to_depth_camera(depthImg, colorImg, &frame.colorInDepthImg);
 		}
 		catch (const k4a::error& e)
 		{
@@ -554,16 +807,10 @@ namespace ofxAzureKinect
 			return false;
 		}
 
-		const auto colorInDepthData = reinterpret_cast<uint8_t*>(this->colorInDepthImg.get_buffer());
+		const auto colorInDepthData = reinterpret_cast<uint8_t*>(frame.colorInDepthImg.get_buffer());
+		frame.colorInDepthPix.setFromExternalPixels(colorInDepthData, frame.colorInDepthImg.get_width_pixels(), frame.colorInDepthImg.get_height_pixels(), OF_PIXELS_BGRA);
 
-		if (!this->colorInDepthPix.isAllocated())
-		{
-			this->colorInDepthPix.allocate(this->colorInDepthImg.get_width_pixels(), this->colorInDepthImg.get_height_pixels(), OF_PIXELS_BGRA);
-		}
-
-		this->colorInDepthPix.setFromPixels(colorInDepthData, this->colorInDepthImg.get_width_pixels(), this->colorInDepthImg.get_height_pixels(), 4);
-
-		ofLogVerbose(__FUNCTION__) << "Color in Depth " << this->colorInDepthImg.get_width_pixels() << "x" << this->colorInDepthImg.get_height_pixels() << " stride: " << this->colorInDepthImg.get_stride_bytes() << ".";
+		ofLogVerbose(__FUNCTION__) << "Color in Depth " << frame.colorInDepthImg.get_width_pixels() << "x" << frame.colorInDepthImg.get_height_pixels() << " stride: " << frame.colorInDepthImg.get_stride_bytes() << ".";
 
 		return true;
 	}
@@ -604,6 +851,11 @@ namespace ofxAzureKinect
 		}
 	}
 
+	int Stream::getJpegDecodeDownscale() const
+	{
+		return this->jpegDecodeDownscale;
+	}
+
 	const k4a::calibration& Stream::getCalibration() const
 	{
 		return this->calibration;
@@ -611,7 +863,7 @@ namespace ofxAzureKinect
 
 	const ofShortPixels& Stream::getDepthPix() const
 	{
-		return this->depthPix;
+		return this->frameBuffer.getFront()->depthPix;
 	}
 
 	const ofTexture& Stream::getDepthTex() const
@@ -621,7 +873,7 @@ namespace ofxAzureKinect
 
 	const ofPixels& Stream::getColorPix() const
 	{
-		return this->colorPix;
+		return this->frameBuffer.getFront()->colorPix;
 	}
 
 	const ofTexture& Stream::getColorTex() const
@@ -631,7 +883,7 @@ namespace ofxAzureKinect
 
 	const ofShortPixels& Stream::getIrPix() const
 	{
-		return this->irPix;
+		return this->frameBuffer.getFront()->irPix;
 	}
 
 	const ofTexture& Stream::getIrTex() const
@@ -659,9 +911,24 @@ namespace ofxAzureKinect
 		return this->colorToWorldTex;
 	}
 
+	const ofShortPixels& Stream::getDepthToWorldHalfPix() const
+	{
+		return this->depthToWorldHalfPix;
+	}
+
+	const ofShortPixels& Stream::getColorToWorldHalfPix() const
+	{
+		return this->colorToWorldHalfPix;
+	}
+
+	bool Stream::isWorldTableHalfFloat() const
+	{
+		return this->bHalfFloatWorldTables;
+	}
+
 	const ofShortPixels& Stream::getDepthInColorPix() const
 	{
-		return this->depthInColorPix;
+		return this->frameBuffer.getFront()->depthInColorPix;
 	}
 
 	const ofTexture& Stream::getDepthInColorTex() const
@@ -671,7 +938,7 @@ namespace ofxAzureKinect
 
 	const ofPixels& Stream::getColorInDepthPix() const
 	{
-		return this->colorInDepthPix;
+		return this->frameBuffer.getFront()->colorInDepthPix;
 	}
 
 	const ofTexture& Stream::getColorInDepthTex() const
@@ -679,11 +946,67 @@ namespace ofxAzureKinect
 		return this->colorInDepthTex;
 	}
 
+	std::shared_ptr<const Frame> Stream::getFrame() const
+	{
+		return this->frameBuffer.getFront();
+	}
+
+	bool Stream::isHeadless() const
+	{
+		return this->bHeadless;
+	}
+
+	std::shared_ptr<const Frame> Stream::pollFrame()
+	{
+		if (!this->bHeadless)
+		{
+			ofLogWarning(__FUNCTION__) << "Frames are picked up in update() when not headless, use getFrame() instead.";
+			return nullptr;
+		}
+
+		// The front frame is ours, give its sensor images back if nobody else is using it.
+		auto& prevFrame = this->frameBuffer.getFront();
+		if (prevFrame && prevFrame.use_count() == 1)
+		{
+			prevFrame->releaseSensorImages();
+		}
+
+		if (this->bodyTracker.isTracking())
+		{
+			this->bodyTracker.updateFrame();
+		}
+
+		if (!this->frameBuffer.swapFront()) return nullptr;
+
+		return this->frameBuffer.getFront();
+	}
+
+	void Stream::setFrameCallback(std::function<void(const std::shared_ptr<const Frame>&)> callback)
+	{
+		std::unique_lock<std::mutex> lock(this->callbackMutex);
+		this->frameCallback = callback;
+	}
+
 	const ofVbo& Stream::getPointCloudVbo() const
 	{
 		return this->pointCloudVbo;
 	}
 
+	const std::vector<BodyPointRange>& Stream::getBodyPointRanges() const
+	{
+		return this->frameBuffer.getFront()->bodyPointRanges;
+	}
+
+	const BodyPointRange& Stream::getBackgroundPointRange() const
+	{
+		return this->frameBuffer.getFront()->backgroundPointRange;
+	}
+
+	std::chrono::microseconds Stream::getBodyPointRangesTimestamp() const
+	{
+		return this->frameBuffer.getFront()->bodyIndexTimestamp;
+	}
+
 	const BodyTracker& Stream::getBodyTracker() const
 	{
 		return this->bodyTracker;
@@ -718,4 +1041,9 @@ namespace ofxAzureKinect
 	{
 		return this->numSuccessiveFails;
 	}
+
+	uint64_t Stream::getNumDroppedFrames() const
+	{
+		return this->frameBuffer.getNumDropped();
+	}
 }
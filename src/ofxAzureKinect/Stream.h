@@ -1,5 +1,7 @@
 #pragma once
 
+#include <deque>
+#include <functional>
 #include <mutex>
 #include <string>
 
@@ -14,6 +16,11 @@
 #include "ofVectorMath.h"
 
 #include "BodyTracker.h"
+#include "Frame.h"
+#include "JpegDecoder.h"
+#include "PointCloudBuilder.h"
+#include "TripleBuffer.h"
+#include "WorldTableCache.h"
 #include "Types.h"
 
 namespace ofxAzureKinect
@@ -40,6 +47,8 @@ namespace ofxAzureKinect
 		virtual FramesPerSecond getCameraFps() const = 0;
 		virtual uint32_t getFramerate() const;
 
+		int getJpegDecodeDownscale() const;
+
 		virtual WiredSyncMode getWiredSyncMode() const = 0;
 		virtual uint32_t getDepthDelayUsec() const = 0;
 		virtual uint32_t getSubordinateDelayUsec() const = 0;
@@ -61,31 +70,60 @@ namespace ofxAzureKinect
 		const ofFloatPixels& getColorToWorldPix() const;
 		const ofTexture& getColorToWorldTex() const;
 
+		// Raw half float x/y pairs, only allocated when the tables are stored at half precision.
+		const ofShortPixels& getDepthToWorldHalfPix() const;
+		const ofShortPixels& getColorToWorldHalfPix() const;
+
+		bool isWorldTableHalfFloat() const;
+
 		const ofShortPixels& getDepthInColorPix() const;
 		const ofTexture& getDepthInColorTex() const;
 
 		const ofPixels& getColorInDepthPix() const;
 		const ofTexture& getColorInDepthTex() const;
 
+		std::shared_ptr<const Frame> getFrame() const;
+
+		bool isHeadless() const;
+
+		// Headless only, returns the latest frame or nullptr if there is nothing new.
+		// The sensor images of the previously polled frame are released if the app let go of it.
+		virtual std::shared_ptr<const Frame> pollFrame();
+
+		// Headless only, called on the capture thread for every frame.
+		// The sensor images are released when it returns, unless it keeps a reference to the frame.
+		void setFrameCallback(std::function<void(const std::shared_ptr<const Frame>&)> callback);
+
 		const ofVbo& getPointCloudVbo() const;
 
+		// Body point clouds only, ranges of the point cloud VBO to draw with draw(GL_POINTS, offset, count).
+		const std::vector<BodyPointRange>& getBodyPointRanges() const;
+		const BodyPointRange& getBackgroundPointRange() const;
+		// Device timestamp of the body index map the ranges were split with, 0 if they weren't, see Frame::bodyIndexTimestamp.
+		std::chrono::microseconds getBodyPointRangesTimestamp() const;
+
 		const BodyTracker& getBodyTracker() const;
 		BodyTracker& getBodyTracker();
 
 		const ofPixels& getBodyIndexPix() const;
 		const ofTexture& getBodyIndexTex() const;
 
-		size_t getNumBodies() const;
-		const std::vector<BodySkeleton>& getBodySkeletons() const;
+		virtual size_t getNumBodies() const;
+		virtual const std::vector<BodySkeleton>& getBodySkeletons() const;
 
 		size_t getNumSuccessiveFails() const;
+		uint64_t getNumDroppedFrames() const;
 
 	protected:
 		virtual bool setupDepthToWorldTable();
 		virtual bool setupColorToWorldTable();
 		virtual bool setupImageToWorldTable(k4a_calibration_type_t type, k4a::image& img);
+		virtual bool setupWorldTableStorage(k4a::image& img, ofFloatPixels& pix, ofShortPixels& halfPix, ofTexture& tex);
+		void resetWorldTables();
+
+		virtual std::vector<uint8_t> getRawCalibration() const;
 
-		virtual bool setupTransformationImages();
+		virtual bool setupTransformationImages(Frame& frame);
 
 		virtual bool startStreaming();
 		virtual bool stopStreaming();
@@ -97,6 +135,11 @@ namespace ofxAzureKinect
 		virtual bool updateCapture() = 0;
 		virtual void releaseCapture();
 
+		bool queueColorDecode();
+
+		void resetFrames();
+		std::shared_ptr<Frame> acquireFrame();
+
 		virtual void updatePixels();
 		virtual void updateTextures();
 
@@ -115,10 +158,12 @@ namespace ofxAzureKinect
 		bool bUpdateWorld;
 		bool bUpdateVbo;
 		bool bForceVboToDepthSize;
-
-		std::condition_variable condition;
-		uint64_t pixFrameNum;
-		uint64_t texFrameNum;
+		bool bCacheWorldTables;
+		bool bHalfFloatWorldTables;
+		bool bBodyPointClouds;
+		bool bBackgroundPointCloud;
+		bool bHeadless;
+		bool bBodyIndexSizeWarned;
 
 		std::string serialNumber;
 
@@ -128,38 +173,56 @@ namespace ofxAzureKinect
 
 		tjhandle jpegDecompressor;
 
+		struct PendingCapture
+		{
+			k4a::capture capture;
+			uint64_t decodeTicket;
+		};
+
+		// Color decoded ahead of time by a subclass, swapped into the next frame instead of decoding.
+		ofPixels decodedColorPix;
+		bool bColorDecoded;
+
+		size_t numDecodeThreads;
+		int jpegDecodeDownscale;
+		JpegDecoder jpegDecoder;
+		std::deque<PendingCapture> pendingCaptures;
+		uint64_t colorDecodeTicket;
+
+		size_t numPointCloudThreads;
+
+		// Sensor thread copies of the tracker's latest body index map, for body point clouds.
+		k4a::image bodyIndexImg;
+		std::vector<uint32_t> bodyIds;
+		std::vector<size_t> bodyBucketOffsets;
+
 		BodyTracker bodyTracker;
 
 		size_t numSuccessiveFails;
 
-		ofShortPixels depthPix;
-		ofTexture depthTex;
+		TripleBuffer<std::shared_ptr<Frame>> frameBuffer;
 
-		ofPixels colorPix;
-		ofTexture colorTex;
+		std::function<void(const std::shared_ptr<const Frame>&)> frameCallback;
+		std::mutex callbackMutex;
 
-		ofShortPixels irPix;
+		ofTexture depthTex;
+		ofTexture colorTex;
 		ofTexture irTex;
 
 		k4a::image depthToWorldImg;
 		ofFloatPixels depthToWorldPix;
+		ofShortPixels depthToWorldHalfPix;
 		ofTexture depthToWorldTex;
 
 		k4a::image colorToWorldImg;
 		ofFloatPixels colorToWorldPix;
+		ofShortPixels colorToWorldHalfPix;
 		ofTexture colorToWorldTex;
 
-		k4a::image depthInColorImg;
-		ofShortPixels depthInColorPix;
 		ofTexture depthInColorTex;
-
-		k4a::image colorInDepthImg;
-		ofPixels colorInDepthPix;
 		ofTexture colorInDepthTex;
 
-		std::vector<glm::vec3> positionCache;
-		std::vector<glm::vec2> uvCache;
-		size_t numPoints;
+		PointCloudBuilder pointCloudBuilder;
 		ofVbo pointCloudVbo;
 	};
 }
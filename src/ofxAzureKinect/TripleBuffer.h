@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace ofxAzureKinect
+{
+	// Lock-free single producer / single consumer triple buffer.
+	// The producer always owns a back slot it can write to without waiting, and the
+	// consumer always picks up the most recently published slot. Slots that get
+	// overwritten before the consumer picks them up are counted as dropped.
+	template<typename T>
+	class TripleBuffer
+	{
+	public:
+		static const size_t NUM_SLOTS = 3;
+
+		TripleBuffer()
+			: backIdx(0)
+			, frontIdx(1)
+			, middleState(2)
+			, numPublished(0)
+			, numDropped(0)
+		{}
+
+		// Producer side.
+		T& getBack()
+		{
+			return this->slots[this->backIdx];
+		}
+
+		void publish()
+		{
+			const uint8_t prevState = this->middleState.exchange(this->backIdx | DIRTY_BIT, std::memory_order_acq_rel);
+			this->backIdx = prevState & INDEX_MASK;
+
+			if (prevState & DIRTY_BIT)
+			{
+				// The consumer never saw the previous slot.
+				++this->numDropped;
+			}
+			++this->numPublished;
+		}
+
+		// Consumer side.
+		bool swapFront()
+		{
+			if (!(this->middleState.load(std::memory_order_acquire) & DIRTY_BIT))
+			{
+				return false;
+			}
+
+			const uint8_t prevState = this->middleState.exchange(this->frontIdx, std::memory_order_acq_rel);
+			this->frontIdx = prevState & INDEX_MASK;
+			return true;
+		}
+
+		T& getFront()
+		{
+			return this->slots[this->frontIdx];
+		}
+
+		const T& getFront() const
+		{
+			return this->slots[this->frontIdx];
+		}
+
+		// Only call when neither side is active.
+		T& getSlot(size_t idx)
+		{
+			return this->slots[idx];
+		}
+
+		void reset()
+		{
+			for (auto& slot : this->slots)
+			{
+				slot = T();
+			}
+
+			this->backIdx = 0;
+			this->frontIdx = 1;
+			this->middleState.store(2);
+			this->numPublished = 0;
+			this->numDropped = 0;
+		}
+
+		uint64_t getNumPublished() const
+		{
+			return this->numPublished;
+		}
+
+		uint64_t getNumDropped() const
+		{
+			return this->numDropped;
+		}
+
+	private:
+		static const uint8_t INDEX_MASK = 0x3;
+		static const uint8_t DIRTY_BIT = 0x4;
+
+		T slots[NUM_SLOTS];
+
+		uint8_t backIdx;
+		uint8_t frontIdx;
+		std::atomic<uint8_t> middleState;
+
+		std::atomic<uint64_t> numPublished;
+		std::atomic<uint64_t> numDropped;
+	};
+}
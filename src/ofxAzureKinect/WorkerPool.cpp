@@ -0,0 +1,133 @@
+#include "WorkerPool.h"
+
+#include "ofLog.h"
+
+namespace ofxAzureKinect
+{
+	WorkerPool::WorkerPool()
+		: bRunning(false)
+		, task(nullptr)
+		, numTasks(0)
+		, nextTask(0)
+		, numDone(0)
+		, batch(0)
+	{}
+
+	WorkerPool::~WorkerPool()
+	{
+		this->close();
+	}
+
+	bool WorkerPool::setup(size_t numThreads)
+	{
+		if (this->bRunning) return false;
+
+		if (numThreads == 0)
+		{
+			ofLogError(__FUNCTION__) << "Pool needs at least one thread!";
+			return false;
+		}
+
+		this->bRunning = true;
+		for (size_t i = 1; i < numThreads; ++i)
+		{
+			this->workers.emplace_back(&WorkerPool::workerFunction, this);
+		}
+
+		return true;
+	}
+
+	bool WorkerPool::close()
+	{
+		if (!this->bRunning) return false;
+
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+			this->bRunning = false;
+		}
+		this->taskCondition.notify_all();
+
+		for (auto& worker : this->workers)
+		{
+			worker.join();
+		}
+		this->workers.clear();
+
+		return true;
+	}
+
+	bool WorkerPool::isRunning() const
+	{
+		return this->bRunning;
+	}
+
+	size_t WorkerPool::getNumThreads() const
+	{
+		return this->workers.size() + 1;
+	}
+
+	void WorkerPool::run(size_t numTasks, const std::function<void(size_t)>& task)
+	{
+		if (this->workers.empty() || numTasks == 1)
+		{
+			for (size_t i = 0; i < numTasks; ++i)
+			{
+				task(i);
+			}
+			return;
+		}
+
+		std::unique_lock<std::mutex> lock(this->mutex);
+		this->task = &task;
+		this->numTasks = numTasks;
+		this->nextTask = 0;
+		this->numDone = 0;
+		++this->batch;
+		this->taskCondition.notify_all();
+
+		while (this->runNextTask(lock));
+
+		this->doneCondition.wait(lock, [this]
+		{
+			return this->numDone == this->numTasks;
+		});
+		this->task = nullptr;
+	}
+
+	void WorkerPool::workerFunction()
+	{
+		uint64_t lastBatch = 0;
+
+		std::unique_lock<std::mutex> lock(this->mutex);
+		while (true)
+		{
+			this->taskCondition.wait(lock, [this, lastBatch]
+			{
+				return !this->bRunning || this->batch != lastBatch;
+			});
+			if (!this->bRunning) break;
+
+			lastBatch = this->batch;
+			while (this->runNextTask(lock));
+		}
+	}
+
+	bool WorkerPool::runNextTask(std::unique_lock<std::mutex>& lock)
+	{
+		if (this->task == nullptr || this->nextTask >= this->numTasks) return false;
+
+		const size_t idx = this->nextTask++;
+		const auto& task = *this->task;
+
+		lock.unlock();
+		task(idx);
+		lock.lock();
+
+		if (++this->numDone == this->numTasks)
+		{
+			this->doneCondition.notify_one();
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ofxAzureKinect
+{
+	// Persistent threads that run a batch of indexed tasks, with the calling thread pitching in.
+	// Batches are meant to be run from one thread at a time.
+	class WorkerPool
+	{
+	public:
+		WorkerPool();
+		~WorkerPool();
+
+		// The thread count includes the calling thread, so 1 runs everything inline.
+		bool setup(size_t numThreads);
+		bool close();
+
+		bool isRunning() const;
+		size_t getNumThreads() const;
+
+		// Runs task(0) to task(numTasks - 1) and returns when they are all done.
+		void run(size_t numTasks, const std::function<void(size_t)>& task);
+
+	private:
+		void workerFunction();
+
+		bool runNextTask(std::unique_lock<std::mutex>& lock);
+
+	private:
+		bool bRunning;
+
+		std::vector<std::thread> workers;
+
+		std::mutex mutex;
+		std::condition_variable taskCondition;
+		std::condition_variable doneCondition;
+
+		const std::function<void(size_t)>* task;
+		size_t numTasks;
+		size_t nextTask;
+		size_t numDone;
+		uint64_t batch;
+	};
+}
@@ -0,0 +1,279 @@
+#include "WorldTableCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "ofFileUtils.h"
+#include "ofLog.h"
+
+namespace
+{
+	const char CACHE_MAGIC[8] = { 'K', '4', 'A', 'W', 'L', 'U', 'T', '\0' };
+	// Bump whenever the tables are generated differently, 2 is the first from CameraModel.
+	const uint32_t CACHE_VERSION = 2;
+
+	// Padded so that the table data after it stays aligned.
+	struct CacheHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t width;
+		uint32_t height;
+		uint32_t stride;
+		uint64_t key;
+		uint8_t reserved[32];
+	};
+	static_assert(sizeof(CacheHeader) == 64, "Unexpected cache header size");
+
+	const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+	const uint64_t FNV_PRIME = 1099511628211ULL;
+
+	uint64_t hashBytes(uint64_t hash, const void* data, size_t size)
+	{
+		const auto bytes = reinterpret_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= FNV_PRIME;
+		}
+		return hash;
+	}
+
+	template<typename T>
+	uint64_t hashValue(uint64_t hash, T value)
+	{
+		const auto widened = static_cast<int64_t>(value);
+		return hashBytes(hash, &widened, sizeof(widened));
+	}
+
+	// Keeps the file mapped for as long as the image wrapping it is alive.
+	struct MappedFile
+	{
+		uint8_t* data = nullptr;
+		size_t size = 0;
+#ifdef _WIN32
+		HANDLE file = INVALID_HANDLE_VALUE;
+		HANDLE mapping = nullptr;
+#endif
+
+		bool open(const std::string& filePath)
+		{
+#ifdef _WIN32
+			this->file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (this->file == INVALID_HANDLE_VALUE) return false;
+
+			LARGE_INTEGER fileSize;
+			if (!GetFileSizeEx(this->file, &fileSize) || fileSize.QuadPart == 0)
+			{
+				this->close();
+				return false;
+			}
+			this->size = static_cast<size_t>(fileSize.QuadPart);
+
+			// Copy on write, the tables are never written back.
+			this->mapping = CreateFileMappingA(this->file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+			if (this->mapping == nullptr)
+			{
+				this->close();
+				return false;
+			}
+
+			this->data = reinterpret_cast<uint8_t*>(MapViewOfFile(this->mapping, FILE_MAP_COPY, 0, 0, 0));
+			if (this->data == nullptr)
+			{
+				this->close();
+				return false;
+			}
+#else
+			const int fd = ::open(filePath.c_str(), O_RDONLY);
+			if (fd < 0) return false;
+
+			struct stat fileStat;
+			if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0)
+			{
+				::close(fd);
+				return false;
+			}
+			this->size = static_cast<size_t>(fileStat.st_size);
+
+			// Copy on write, the tables are never written back.
+			void* addr = mmap(nullptr, this->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+			::close(fd);
+			if (addr == MAP_FAILED) return false;
+
+			this->data = reinterpret_cast<uint8_t*>(addr);
+#endif
+			return true;
+		}
+
+		void close()
+		{
+#ifdef _WIN32
+			if (this->data) UnmapViewOfFile(this->data);
+			if (this->mapping) CloseHandle(this->mapping);
+			if (this->file != INVALID_HANDLE_VALUE) CloseHandle(this->file);
+			this->mapping = nullptr;
+			this->file = INVALID_HANDLE_VALUE;
+#else
+			if (this->data) munmap(this->data, this->size);
+#endif
+			this->data = nullptr;
+			this->size = 0;
+		}
+	};
+
+	void releaseMappedFile(void* /*buffer*/, void* context)
+	{
+		auto mappedFile = reinterpret_cast<MappedFile*>(context);
+		mappedFile->close();
+		delete mappedFile;
+	}
+}
+
+namespace ofxAzureKinect
+{
+	uint64_t WorldTableCache::makeKey(const std::vector<uint8_t>& rawCalibration, const k4a::calibration& calibration, k4a_calibration_type_t type)
+	{
+		uint64_t hash = FNV_OFFSET_BASIS;
+		if (rawCalibration.empty())
+		{
+			// No raw blob available, fall back to the parsed camera parameters.
+			const k4a_calibration_camera_t& calibrationCamera = (type == K4A_CALIBRATION_TYPE_DEPTH) ? calibration.depth_camera_calibration : calibration.color_camera_calibration;
+			hash = hashBytes(hash, &calibrationCamera, sizeof(calibrationCamera));
+		}
+		else
+		{
+			hash = hashBytes(hash, rawCalibration.data(), rawCalibration.size());
+		}
+		hash = hashValue(hash, calibration.depth_mode);
+		hash = hashValue(hash, calibration.color_resolution);
+		hash = hashValue(hash, type);
+		return hash;
+	}
+
+	std::string WorldTableCache::getFilePath(const std::string& cacheDir, k4a_calibration_type_t type, uint64_t key)
+	{
+		std::ostringstream oss;
+		oss << ((type == K4A_CALIBRATION_TYPE_DEPTH) ? "depthToWorld_" : "colorToWorld_")
+			<< std::hex << std::setw(16) << std::setfill('0') << key << ".lut";
+		return ofFilePath::join(cacheDir, oss.str());
+	}
+
+	bool WorldTableCache::load(const std::string& filePath, uint64_t key, int width, int height, k4a::image& img)
+	{
+		if (!ofFile::doesFileExist(filePath, false)) return false;
+
+		auto mappedFile = new MappedFile();
+		if (!mappedFile->open(filePath))
+		{
+			ofLogWarning(__FUNCTION__) << "Could not map " << filePath;
+			delete mappedFile;
+			return false;
+		}
+
+		const int stride = width * static_cast<int>(sizeof(k4a_float2_t));
+		const size_t dataSize = static_cast<size_t>(stride) * height;
+
+		CacheHeader header;
+		bool bValid = mappedFile->size == sizeof(CacheHeader) + dataSize;
+		if (bValid)
+		{
+			std::memcpy(&header, mappedFile->data, sizeof(CacheHeader));
+			bValid = std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 &&
+				header.version == CACHE_VERSION &&
+				header.key == key &&
+				header.width == static_cast<uint32_t>(width) &&
+				header.height == static_cast<uint32_t>(height) &&
+				header.stride == static_cast<uint32_t>(stride);
+		}
+		if (!bValid)
+		{
+			ofLogWarning(__FUNCTION__) << "Ignoring stale or corrupt table " << filePath;
+			releaseMappedFile(nullptr, mappedFile);
+			return false;
+		}
+
+		try
+		{
+			// The image owns the mapping from here on.
+			img = k4a::image::create_from_buffer(K4A_IMAGE_FORMAT_CUSTOM,
+				width, height, stride,
+				mappedFile->data + sizeof(CacheHeader), dataSize,
+				releaseMappedFile, mappedFile);
+		}
+		catch (const k4a::error& e)
+		{
+			ofLogError(__FUNCTION__) << e.what();
+			releaseMappedFile(nullptr, mappedFile);
+			return false;
+		}
+
+		return true;
+	}
+
+	bool WorldTableCache::save(const std::string& filePath, uint64_t key, const k4a::image& img)
+	{
+		const std::string cacheDir = ofFilePath::getEnclosingDirectory(filePath, false);
+		if (!ofDirectory::doesDirectoryExist(cacheDir, false))
+		{
+			ofDirectory::createDirectory(cacheDir, false, true);
+		}
+
+		CacheHeader header;
+		std::memset(&header, 0, sizeof(CacheHeader));
+		std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+		header.version = CACHE_VERSION;
+		header.width = static_cast<uint32_t>(img.get_width_pixels());
+		header.height = static_cast<uint32_t>(img.get_height_pixels());
+		header.stride = static_cast<uint32_t>(img.get_stride_bytes());
+		header.key = key;
+
+		// Write to a temp file first so that a crash never leaves a partial table behind.
+		const std::string tempPath = filePath + ".tmp";
+		{
+			std::ofstream ofs(tempPath, std::ios::binary | std::ios::trunc);
+			if (!ofs)
+			{
+				ofLogError(__FUNCTION__) << "Could not open " << tempPath << " for writing";
+				return false;
+			}
+
+			ofs.write(reinterpret_cast<const char*>(&header), sizeof(CacheHeader));
+			ofs.write(reinterpret_cast<const char*>(img.get_buffer()), static_cast<std::streamsize>(header.stride) * header.height);
+			if (!ofs)
+			{
+				ofLogError(__FUNCTION__) << "Failed writing " << tempPath;
+				ofs.close();
+				std::remove(tempPath.c_str());
+				return false;
+			}
+		}
+
+#ifdef _WIN32
+		// Windows won't rename over an existing file.
+		std::remove(filePath.c_str());
+#endif
+		if (std::rename(tempPath.c_str(), filePath.c_str()) != 0)
+		{
+			ofLogError(__FUNCTION__) << "Could not move " << tempPath << " to " << filePath;
+			std::remove(tempPath.c_str());
+			return false;
+		}
+
+		return true;
+	}
+}
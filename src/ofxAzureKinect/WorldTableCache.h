@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <k4a/k4a.hpp>
+
+namespace ofxAzureKinect
+{
+	// Stores image-to-world tables on disk so they only need to be generated once per calibration.
+	// Tables are keyed by a hash of the raw calibration, the camera modes and the table type,
+	// and loaded back through a memory map.
+	class WorldTableCache
+	{
+	public:
+		static uint64_t makeKey(const std::vector<uint8_t>& rawCalibration, const k4a::calibration& calibration, k4a_calibration_type_t type);
+
+		static std::string getFilePath(const std::string& cacheDir, k4a_calibration_type_t type, uint64_t key);
+
+		static bool load(const std::string& filePath, uint64_t key, int width, int height, k4a::image& img);
+		static bool save(const std::string& filePath, uint64_t key, const k4a::image& img);
+	};
+}